@@ -4,8 +4,8 @@ function plotMss(mssData, ssthreshData, ssPhaseData, caPhaseData, frPhaseData, c
 
     maxY = max(mssData(:, 2) + 2);
     maxBgY = min([maxY]);
-    ssPhaseL = length(ssPhaseData);
-    caPhaseL = length(caPhaseData);
+    ssPhaseL = size(ssPhaseData, 1);
+    caPhaseL = size(caPhaseData, 1);
     frPhaseL = length(frPhaseData);
     congL = length(congData);
     pSsPhase = 0;
@@ -0,0 +1,30 @@
+function plotSlidingMss(rtt, dTitle)
+%PLOTSLIDINGMSS Plots the window traces of PAK-Sliding-Window with plotMss
+%   Reads the pak-sliding-*.dat files the scenario writes into the current
+%   directory. rtt is the round trip time in seconds the time axis is
+%   divided by, so the plot is in RTT like the TCP ones.
+
+    mssData = load('pak-sliding-cwnd.dat');
+    ssthreshData = load('pak-sliding-ssthresh.dat');
+    phaseData = load('pak-sliding-phase.dat');
+    congData = load('pak-sliding-congestion.dat');
+    
+    mssData(:, 1) = mssData(:, 1) / rtt;
+    ssthreshData(:, 1) = ssthreshData(:, 1) / rtt;
+    congData = congData / rtt;
+    
+    % only phase changes are traced, the client starts in slow start
+    phaseData = [0, 0; phaseData];
+    phaseData(:, 1) = phaseData(:, 1) / rtt;
+    phaseEnd = [phaseData(2:end, 1); max(mssData(:, 1))];
+    
+    % 0 slow start, 1 congestion avoidance, 2 recovery
+    ss = phaseData(:, 2) == 0;
+    ca = phaseData(:, 2) == 1;
+    ssPhaseData = [phaseData(ss, 1), phaseEnd(ss)];
+    caPhaseData = [phaseData(ca, 1), phaseEnd(ca)];
+    frPhaseData = phaseData(phaseData(:, 2) == 2, 1);
+    
+    figure;
+    plotMss(mssData, ssthreshData, ssPhaseData, caPhaseData, frPhaseData, congData, dTitle);
+end
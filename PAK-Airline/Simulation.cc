@@ -20,7 +20,14 @@
 #include "ns3/point-to-point-module.h"
 #include "ns3/point-to-point-star.h"
 #include "ns3/applications-module.h"
-#include "ns3/int64x64-128.h"
+
+#include "../PAK-Common/pak-results.h"
+#include "../PAK-Common/pak-pcap.h"
+#include "../PAK-Common/pak-stats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
 
 using namespace ns3;
 
@@ -30,15 +37,24 @@ NS_LOG_COMPONENT_DEFINE("PakAirlineStreaming");
 #define	SERVER_IDX	"0"
 #define FIRST_CLIENT_ID	1
 
-int64x64_t sent = 0;
-int64x64_t recv = 0;
+/**
+ * Packets streamed to one seat, kept in one vector indexed by client id - FIRST_CLIENT_ID.
+ */
+struct SeatCounters {
+	SeatCounters()
+		: sent(0)
+		, received(0) {}
 
-void SendCb(const Ptr<const Packet>) {
-	sent += int64x64_t(1);
+	uint64_t	sent;
+	uint64_t	received;
+};
+
+void SendCb(uint64_t* sent, Ptr<const Packet>) {
+	(*sent)++;
 }
 
-void RecvCb(const Ptr<const Packet>, const Address&) {
-	recv += int64x64_t(1);
+void RecvCb(uint64_t* received, Ptr<const Packet>, const Address&) {
+	(*received)++;
 }
 
 int main(int argc, char *argv[]) {
@@ -51,11 +67,23 @@ int main(int argc, char *argv[]) {
 	uint32_t runtime = 2400;
 	// double errRate = 0.05;
 
+	PakResults results("PAK-Airline");
+	PakPcap pcap("pak-airline");
+	PakFlowStats stats;
+
 	CommandLine cmd;
 	cmd.AddValue("client-count", "Number of streaming clients", nClients);
 	cmd.AddValue("runtime", "Length in seconds to run this simulation", runtime);
+	results.AddOptions(cmd);
+	pcap.AddOptions(cmd);
+	stats.AddOptions(cmd);
 	cmd.Parse(argc, argv);
 
+	results.SetParameter("client-count", nClients);
+	results.SetParameter("runtime", runtime);
+	results.SetParameter("pcap", pcap.GetMode());
+	results.SetParameter("pcapSnapLen", pcap.GetSnapLen());
+
 
 	PointToPointHelper p2p;
 	p2p.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
@@ -112,25 +140,72 @@ int main(int argc, char *argv[]) {
 	clientApps.Stop(Seconds(50.0 + runtime));
 
 
-	Config::ConnectWithoutContext("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx", MakeCallback(&SendCb));
-	Config::ConnectWithoutContext("/NodeList/*/ApplicationList/0/$ns3::PacketSink/Rx", MakeCallback(&RecvCb));
+	// server application and sink i - FIRST_CLIENT_ID belong to seat i, the
+	// callbacks only increment that seat's counter instead of matching config paths
+	std::vector<SeatCounters> seats(nClients);
+
+	for (uint32_t i = 0; i < nClients; ++i) {
+		serverApps.Get(i)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&SendCb, &seats[i].sent));
+		clientApps.Get(i)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&RecvCb, &seats[i].received));
+	}
+
+	if (stats.IsEnabled()) {
+		stats.Init(Seconds(100.0 + runtime));
+		Config::ConnectWithoutContext("/NodeList/*/ApplicationList/*/$ns3::OnOffApplication/Tx", MakeCallback(&PakFlowStats::Tx, &stats));
+		Config::ConnectWithoutContext("/NodeList/*/ApplicationList/0/$ns3::PacketSink/Rx", MakeCallback(&PakFlowStats::Rx, &stats));
+	}
 
 
-	p2p.EnablePcapAll("pak-airline");
+	pcap.Enable(p2p);
 
 
 	Simulator::Stop(Seconds(100.0 + runtime));
+	results.StartRun();
 	Simulator::Run();
+	results.StopRun();
 
 	Simulator::Destroy();
 
 
-	int64x64_t del_ratio = int64x64_t(100) - int64x64_t(100) * recv / sent;
+	uint64_t sent = 0;
+	uint64_t recv = 0;
+	std::vector<double> ratios;
+	ratios.reserve(nClients);
 
-	// printf("recv/sent: %lu/%lu\n", recv.GetHigh(), sent.GetHigh());
-	// printf("loss ratio: %lu%%\n", 100 - del_ratio.GetHigh());
+	// seat id, packets sent, packets received and delivery ratio in percent, one seat per line as loaded by Matlab
+	std::ofstream seatFile("pak-airline-seats.dat");
+
+	for (uint32_t i = 0; i < nClients; ++i) {
+		sent += seats[i].sent;
+		recv += seats[i].received;
+
+		double ratio = seats[i].sent > 0 ? 100. * seats[i].received / seats[i].sent : 100.;
+		ratios.push_back(ratio);
+		seatFile << (i + FIRST_CLIENT_ID) << "\t" << seats[i].sent << "\t" << seats[i].received << "\t" << ratio << std::endl;
+	}
+
+	double ratioSum = 0;
+
+	for (std::vector<double>::const_iterator it = ratios.begin(); it != ratios.end(); ++it) {
+		ratioSum += *it;
+	}
+
+	std::sort(ratios.begin(), ratios.end());
+
+	results.AddMetric("Packets sent", sent);
+	results.AddMetric("Packets received", recv);
+	results.AddMetric("Loss ratio", sent > 0 ? 100. - 100. * recv / sent : 0., "%");
+
+	if (!ratios.empty()) {
+		results.AddMetric("Seat delivery ratio min", ratios.front(), "%");
+		results.AddMetric("Seat delivery ratio p10", ratios[ratios.size() / 10], "%");
+		results.AddMetric("Seat delivery ratio median", ratios[ratios.size() / 2], "%");
+		results.AddMetric("Seat delivery ratio mean", ratioSum / ratios.size(), "%");
+		results.AddMetric("Seat delivery ratio max", ratios.back(), "%");
+	}
 
-	printf("%2.2f\n", del_ratio.GetDouble());
+	stats.Write(results);
+	results.Write();
 
 
 	return 0;
@@ -0,0 +1,125 @@
+#ifndef PAK_PCAP_H
+#define PAK_PCAP_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Common --pcap and --pcapSnapLen options of the PAK scenarios.
+ *
+ * --pcap=all traces every device, --pcap=none nothing and
+ * --pcap=nodes:0,2-4 only the devices of the listed nodes.
+ * --pcapSnapLen limits the bytes captured per packet, 0 captures
+ * whole packets.
+ */
+class PakPcap {
+public:
+	PakPcap(std::string prefix, std::string defaultMode = "all")
+		: m_prefix(prefix)
+		, m_defaultMode(defaultMode)
+		, m_snapLen(0) {}
+
+	/**
+	 * Registers the options, call before CommandLine::Parse().
+	 */
+	void AddOptions(CommandLine& cmd) {
+		cmd.AddValue("pcap", "Devices to write pcap traces for: none, all or nodes:<id,id-id,...>, the scenario's default if empty", m_mode);
+		cmd.AddValue("pcapSnapLen", "Maximum number of bytes captured per packet, 0 for whole packets", m_snapLen);
+	}
+
+	/**
+	 * Mode used if --pcap was not given, may be changed after CommandLine::Parse().
+	 */
+	void SetDefaultMode(std::string mode) {
+		m_defaultMode = mode;
+	}
+
+	std::string GetMode(void) const {
+		return m_mode.empty() ? m_defaultMode : m_mode;
+	}
+
+	uint32_t GetSnapLen(void) const {
+		return m_snapLen;
+	}
+
+	/**
+	 * Enables the traces on the devices installed by helper. Call after the
+	 * nodes and devices are created.
+	 */
+	void Enable(PcapHelperForDevice& helper, bool promiscuous = false) {
+		std::string mode = GetMode();
+
+		if (mode == "none") {
+			return;
+		}
+
+		if (m_snapLen > 0) {
+			Config::SetDefault("ns3::PcapFileWrapper::CaptureSize", UintegerValue(m_snapLen));
+		}
+
+		if (mode == "all") {
+			helper.EnablePcapAll(m_prefix, promiscuous);
+			return;
+		}
+
+		if (mode.compare(0, 6, "nodes:") != 0) {
+			NS_FATAL_ERROR("Invalid --pcap=" << mode << ", expected none, all or nodes:<list>");
+		}
+
+		NodeContainer nodes;
+		std::istringstream list(mode.substr(6));
+		std::string range;
+
+		while (std::getline(list, range, ',')) {
+			size_t dash = range.find('-');
+			uint32_t first = ParseNodeId(mode, range.substr(0, dash));
+			uint32_t last = dash == std::string::npos ? first : ParseNodeId(mode, range.substr(dash + 1));
+
+			if (first > last) {
+				NS_FATAL_ERROR("Invalid --pcap=" << mode << ", the range " << range << " is empty");
+			}
+
+			for (uint32_t id = first; id <= last; id++) {
+				if (id >= NodeList::GetNNodes()) {
+					NS_FATAL_ERROR("Invalid --pcap=" << mode << ", there is no node " << id);
+				}
+
+				nodes.Add(NodeList::GetNode(id));
+			}
+		}
+
+		if (nodes.GetN() == 0) {
+			NS_FATAL_ERROR("Invalid --pcap=" << mode << ", it lists no node");
+		}
+
+		helper.EnablePcap(m_prefix, nodes, promiscuous);
+	}
+
+private:
+	static uint32_t ParseNodeId(const std::string& mode, const std::string& id) {
+		char* end = NULL;
+		unsigned long value = std::strtoul(id.c_str(), &end, 10);
+
+		// strtoul would also take signs and spaces, and read nothing as 0
+		if (id.empty() || id.find_first_not_of("0123456789") != std::string::npos || *end != '\0' || value > 0xffffffffUL) {
+			NS_FATAL_ERROR("Invalid --pcap=" << mode << ", \"" << id << "\" is not a node id");
+		}
+
+		return value;
+	}
+
+	std::string	m_prefix;
+	std::string	m_defaultMode;
+	std::string	m_mode;		//!< Empty unless --pcap was given
+	uint32_t	m_snapLen;
+};
+
+} // namespace ns3
+
+#endif /* PAK_PCAP_H */
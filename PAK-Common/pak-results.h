@@ -0,0 +1,388 @@
+#ifndef PAK_RESULTS_H
+#define PAK_RESULTS_H
+
+#include "ns3/core-module.h"
+#include "ns3/event-impl.h"
+#include "ns3/global-value.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/scheduler.h"
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Header only, every PAK scenario is a single ns-3 program that includes
+ * this file from its Simulation.cc.
+ */
+
+namespace ns3 {
+
+/**
+ * Wraps the scheduler of type Scheduler and counts the events it hands to
+ * the simulator that are executed. Cancelled events are dequeued as well,
+ * but the simulator skips them, so they are not counted.
+ */
+class PakEventCountingScheduler : public Scheduler {
+public:
+	static TypeId GetTypeId(void) {
+		static TypeId tid = TypeId("ns3::PakEventCountingScheduler")
+			.SetParent<Scheduler>()
+			.SetGroupName("Core")
+			.AddConstructor<PakEventCountingScheduler>()
+			.AddAttribute("Scheduler", "Type of the scheduler that orders the events.",
+				TypeIdValue(MapScheduler::GetTypeId()),
+				MakeTypeIdAccessor(&PakEventCountingScheduler::SetScheduler),
+				MakeTypeIdChecker())
+			;
+
+		return tid;
+	}
+
+	void SetScheduler(TypeId type) {
+		ObjectFactory factory;
+		factory.SetTypeId(type);
+		m_scheduler = factory.Create<Scheduler>();
+	}
+
+	virtual void Insert(const Scheduler::Event& ev) {
+		m_scheduler->Insert(ev);
+	}
+
+	virtual bool IsEmpty(void) const {
+		return m_scheduler->IsEmpty();
+	}
+
+	virtual Scheduler::Event PeekNext(void) const {
+		return m_scheduler->PeekNext();
+	}
+
+	virtual Scheduler::Event RemoveNext(void) {
+		Scheduler::Event ev = m_scheduler->RemoveNext();
+
+		if (!ev.impl->IsCancelled()) {
+			GetEventCount()++;
+		}
+
+		return ev;
+	}
+
+	virtual void Remove(const Scheduler::Event& ev) {
+		m_scheduler->Remove(ev);
+	}
+
+	static uint64_t& GetEventCount(void) {
+		static uint64_t count = 0;
+
+		return count;
+	}
+
+private:
+	Ptr<Scheduler>	m_scheduler;
+};
+
+/**
+ * Collects the parameters and metrics of one simulation run, prints the
+ * metrics and appends one record per run to the file given with --results:
+ * a JSON object per line for *.json, a CSV row for anything else. The CSV
+ * header is written when the file is new. A row whose columns differ from
+ * the header of an existing file is not appended, so one file should only
+ * collect runs of one scenario with the same options.
+ */
+class PakResults {
+public:
+	PakResults(std::string scenario)
+		: m_scenario(scenario)
+		, m_tabular(false)
+		, m_wallClockTime(0)
+		, m_events(0) {}
+
+	/**
+	 * Registers --results, call before CommandLine::Parse().
+	 */
+	void AddOptions(CommandLine& cmd) {
+		cmd.AddValue("results", "File a JSON (*.json) or CSV record of this run is appended to", m_path);
+	}
+
+	/**
+	 * Prints the metrics as "name<TAB>value" lines instead of "name: value unit".
+	 */
+	void SetTabular(bool tabular) {
+		m_tabular = tabular;
+	}
+
+	template<typename T>
+	void SetParameter(std::string name, const T& value) {
+		m_parameters.push_back(std::make_pair(name, Format(value)));
+	}
+
+	template<typename T>
+	void AddMetric(std::string name, const T& value, std::string unit = "") {
+		Value v = Format(value);
+		m_metrics.push_back(std::make_pair(name, v));
+
+		if (m_tabular) {
+			std::cout << name << "\t" << v.m_text << std::endl;
+		}
+		else {
+			std::cout << name << ": " << v.m_text << unit << std::endl;
+		}
+	}
+
+	/**
+	 * Call right before Simulator::Run(). The events are still ordered by
+	 * the scheduler chosen with --SchedulerType.
+	 */
+	void StartRun(void) {
+		TypeIdValue type;
+		GlobalValue::GetValueByName("SchedulerType", type);
+
+		ObjectFactory scheduler;
+		scheduler.SetTypeId(PakEventCountingScheduler::GetTypeId());
+		scheduler.Set("Scheduler", type);
+		Simulator::SetScheduler(scheduler);
+
+		PakEventCountingScheduler::GetEventCount() = 0;
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * Call right after Simulator::Run(), before Simulator::Destroy().
+	 */
+	void StopRun(void) {
+		m_wallClockTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		m_simulatedTime = Simulator::Now();
+		m_events = PakEventCountingScheduler::GetEventCount();
+	}
+
+	/**
+	 * Appends the record of this run if --results was given.
+	 */
+	bool Write(void) {
+		if (m_path.empty()) {
+			return true;
+		}
+
+		bool json = m_path.size() >= 5 && m_path.compare(m_path.size() - 5, 5, ".json") == 0;
+		std::string header;
+
+		if (!json) {
+			std::ifstream existing(m_path.c_str());
+			std::getline(existing, header);
+
+			// appending to different columns would shift every value into the wrong one
+			if (!header.empty() && header != GetCsvHeader()) {
+				std::cerr << "The columns of this run do not match the header of " << m_path << ", not appending" << std::endl;
+				return false;
+			}
+		}
+
+		std::ofstream file(m_path.c_str(), std::ios::app);
+
+		if (!file) {
+			std::cerr << "Cannot write results to " << m_path << std::endl;
+			return false;
+		}
+
+		if (json) {
+			WriteJson(file);
+		}
+		else {
+			WriteCsv(file, header.empty());
+		}
+
+		return file.good();
+	}
+
+	/**
+	 * Joins fields to one CSV line, quoting them where needed.
+	 */
+	static std::string FormatCsvRow(const std::vector<std::string>& fields) {
+		std::string row;
+
+		for (std::vector<std::string>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+			row += (it == fields.begin() ? "" : ",") + QuoteCsv(*it);
+		}
+
+		return row;
+	}
+
+private:
+	struct Value {
+		std::string	m_text;
+		bool		m_string;	//!< Quoted in JSON
+	};
+
+	typedef std::vector<std::pair<std::string, Value> > Values;
+
+	template<typename T>
+	static Value Format(const T& value, typename std::enable_if<std::is_arithmetic<T>::value>::type* = 0) {
+		std::ostringstream os;
+		Value v;
+		v.m_string = false;
+
+		if (std::is_same<T, bool>::value) {
+			os << (value ? "true" : "false");
+		}
+		else if (std::is_floating_point<T>::value) {
+			if (std::isfinite(static_cast<double>(value))) {
+				os << std::fixed << value;
+			}
+			else {
+				os << "null";
+			}
+		}
+		else {
+			// print uint8_t and int8_t as numbers, not characters
+			os << +value;
+		}
+
+		v.m_text = os.str();
+
+		return v;
+	}
+
+	static Value Format(const std::string& value) {
+		Value v;
+		v.m_text = value;
+		v.m_string = true;
+
+		return v;
+	}
+
+	static Value Format(const char* value) {
+		return Format(std::string(value));
+	}
+
+	static Value Format(const Time& value) {
+		return Format(value.GetSeconds());
+	}
+
+	static std::string QuoteJson(const std::string& s) {
+		std::ostringstream os;
+		os << '"';
+
+		for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+			if (*it == '"' || *it == '\\') {
+				os << '\\' << *it;
+			}
+			else if (static_cast<unsigned char>(*it) < 0x20) {
+				os << "\\u00" << "0123456789abcdef"[(*it >> 4) & 0xf] << "0123456789abcdef"[*it & 0xf];
+			}
+			else {
+				os << *it;
+			}
+		}
+
+		os << '"';
+
+		return os.str();
+	}
+
+	static std::string QuoteCsv(const std::string& s) {
+		if (s.find_first_of(",\"\r\n") == std::string::npos) {
+			return s;
+		}
+
+		std::string quoted = "\"";
+
+		for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+			quoted += *it;
+
+			if (*it == '"') {
+				quoted += '"';
+			}
+		}
+
+		return quoted + "\"";
+	}
+
+	static void WriteJsonValues(std::ostream& os, const Values& values) {
+		os << "{";
+
+		for (Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+			os << (it == values.begin() ? "" : ",") << QuoteJson(it->first) << ":";
+			os << (it->second.m_string ? QuoteJson(it->second.m_text) : it->second.m_text);
+		}
+
+		os << "}";
+	}
+
+	void WriteJson(std::ostream& os) const {
+		os << "{\"scenario\":" << QuoteJson(m_scenario);
+		os << ",\"seed\":" << RngSeedManager::GetSeed();
+		os << ",\"run\":" << RngSeedManager::GetRun();
+		os << ",\"wallClockTime\":" << std::fixed << m_wallClockTime;
+		os << ",\"simulatedTime\":" << std::fixed << m_simulatedTime.GetSeconds();
+		os << ",\"events\":" << m_events;
+		os << ",\"parameters\":";
+		WriteJsonValues(os, m_parameters);
+		os << ",\"metrics\":";
+		WriteJsonValues(os, m_metrics);
+		os << "}" << std::endl;
+	}
+
+	std::string GetCsvHeader(void) const {
+		std::vector<std::string> fields;
+		fields.push_back("scenario");
+		fields.push_back("seed");
+		fields.push_back("run");
+		fields.push_back("wallClockTime");
+		fields.push_back("simulatedTime");
+		fields.push_back("events");
+
+		for (Values::const_iterator it = m_parameters.begin(); it != m_parameters.end(); ++it) {
+			fields.push_back(it->first);
+		}
+
+		for (Values::const_iterator it = m_metrics.begin(); it != m_metrics.end(); ++it) {
+			fields.push_back(it->first);
+		}
+
+		return FormatCsvRow(fields);
+	}
+
+	void WriteCsv(std::ostream& os, bool header) const {
+		if (header) {
+			os << GetCsvHeader() << std::endl;
+		}
+
+		std::vector<std::string> fields;
+		fields.push_back(m_scenario);
+		fields.push_back(Format(RngSeedManager::GetSeed()).m_text);
+		fields.push_back(Format(RngSeedManager::GetRun()).m_text);
+		fields.push_back(Format(m_wallClockTime).m_text);
+		fields.push_back(Format(m_simulatedTime).m_text);
+		fields.push_back(Format(m_events).m_text);
+
+		for (Values::const_iterator it = m_parameters.begin(); it != m_parameters.end(); ++it) {
+			fields.push_back(it->second.m_text);
+		}
+
+		for (Values::const_iterator it = m_metrics.begin(); it != m_metrics.end(); ++it) {
+			fields.push_back(it->second.m_text);
+		}
+
+		os << FormatCsvRow(fields) << std::endl;
+	}
+
+	std::string	m_scenario;
+	std::string	m_path;
+	bool		m_tabular;
+	Values		m_parameters;
+	Values		m_metrics;
+	std::chrono::steady_clock::time_point m_start;
+	double		m_wallClockTime;
+	Time		m_simulatedTime;
+	uint64_t	m_events;
+};
+
+} // namespace ns3
+
+#endif /* PAK_RESULTS_H */
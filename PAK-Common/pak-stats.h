@@ -0,0 +1,273 @@
+#ifndef PAK_STATS_H
+#define PAK_STATS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include "pak-results.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Log-linear histogram in the style of HdrHistogram: 32 buckets per power
+ * of two, so every recorded value is known within 3 %, in constant memory
+ * for the whole uint64_t range.
+ */
+class PakHistogram {
+public:
+	static const uint32_t SUB_BITS = 5;
+	static const uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+	static const uint32_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+	PakHistogram()
+		: m_buckets(BUCKETS, 0)
+		, m_count(0)
+		, m_min(0)
+		, m_max(0) {}
+
+	void Add(uint64_t value) {
+		m_buckets[GetBucket(value)]++;
+		m_min = m_count == 0 ? value : std::min(m_min, value);
+		m_max = std::max(m_max, value);
+		m_count++;
+	}
+
+	uint64_t GetCount(void) const {
+		return m_count;
+	}
+
+	uint64_t GetMin(void) const {
+		return m_min;
+	}
+
+	uint64_t GetMax(void) const {
+		return m_max;
+	}
+
+	/**
+	 * Value below which the fraction q of all recorded values lies, 0 if empty.
+	 */
+	uint64_t GetQuantile(double q) const {
+		if (m_count == 0) {
+			return 0;
+		}
+
+		uint64_t rank = std::min<uint64_t>(q * m_count, m_count - 1);
+		uint64_t seen = 0;
+
+		for (uint32_t i = 0; i < BUCKETS; i++) {
+			seen += m_buckets[i];
+
+			if (seen > rank) {
+				return std::min(std::max(GetValue(i), m_min), m_max);
+			}
+		}
+
+		return m_max;
+	}
+
+private:
+	static uint32_t GetBucket(uint64_t value) {
+		if (value < SUB_BUCKETS) {
+			return value;
+		}
+
+		uint32_t exponent = 63;
+
+		while (!(value >> exponent)) {
+			exponent--;
+		}
+
+		uint32_t shift = exponent - SUB_BITS;
+
+		return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+	}
+
+	/**
+	 * Middle of the values falling into bucket i.
+	 */
+	static uint64_t GetValue(uint32_t i) {
+		if (i < SUB_BUCKETS) {
+			return i;
+		}
+
+		uint32_t shift = i / SUB_BUCKETS - 1;
+		uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+
+		return lower + ((static_cast<uint64_t>(1) << shift) >> 1);
+	}
+
+	std::vector<uint64_t> m_buckets;
+	uint64_t	m_count;
+	uint64_t	m_min;
+	uint64_t	m_max;
+};
+
+/**
+ * Collects the traffic of a scenario while it runs: sent, received,
+ * enqueued and dropped packets and bytes per time bin, and the
+ * distributions of RTT samples and per-bin throughput. The number of bins
+ * is fixed by the run length, so memory does not grow with the traffic.
+ *
+ * The collector is only active with --stats=<file>, which receives one
+ * tab separated line per bin.
+ */
+class PakFlowStats {
+public:
+	PakFlowStats()
+		: m_binWidth(1.0) {}
+
+	/**
+	 * Registers --stats and --statsBin, call before CommandLine::Parse().
+	 */
+	void AddOptions(CommandLine& cmd) {
+		cmd.AddValue("stats", "File the time binned flow statistics are written to, none if empty", m_path);
+		cmd.AddValue("statsBin", "Length of one time bin of the flow statistics in seconds", m_binWidth);
+	}
+
+	bool IsEnabled(void) const {
+		return !m_path.empty();
+	}
+
+	/**
+	 * Allocates the bins for a run of the given length, call after
+	 * CommandLine::Parse() and before any packet is traced.
+	 */
+	void Init(Time duration) {
+		if (m_binWidth <= 0) {
+			NS_FATAL_ERROR("--statsBin must be positive");
+		}
+
+		m_bins.assign(static_cast<size_t>(duration.GetSeconds() / m_binWidth) + 1, Bin());
+	}
+
+	void Tx(Ptr<const Packet> packet) {
+		Bin& bin = GetBin();
+		bin.m_txPackets++;
+		bin.m_txBytes += packet->GetSize();
+	}
+
+	void Rx(Ptr<const Packet> packet, const Address&) {
+		Bin& bin = GetBin();
+		bin.m_rxPackets++;
+		bin.m_rxBytes += packet->GetSize();
+	}
+
+	void Enqueue(Ptr<const QueueItem>) {
+		GetBin().m_enqueued++;
+	}
+
+	void Drop(Ptr<const QueueItem> item) {
+		Bin& bin = GetBin();
+		bin.m_dropped++;
+		bin.m_droppedBytes += item->GetPacket()->GetSize();
+	}
+
+	void Rtt(Time rtt) {
+		m_rtt.Add(rtt.GetMicroSeconds());
+	}
+
+	/**
+	 * Adds the totals and quantiles to results and writes the bins to the
+	 * --stats file.
+	 */
+	bool Write(PakResults& results) {
+		if (!IsEnabled()) {
+			return true;
+		}
+
+		Bin total;
+		PakHistogram throughput;
+
+		for (std::vector<Bin>::iterator it = m_bins.begin(); it != m_bins.end(); ++it) {
+			total.m_txPackets += it->m_txPackets;
+			total.m_txBytes += it->m_txBytes;
+			total.m_rxPackets += it->m_rxPackets;
+			total.m_rxBytes += it->m_rxBytes;
+			total.m_enqueued += it->m_enqueued;
+			total.m_dropped += it->m_dropped;
+			total.m_droppedBytes += it->m_droppedBytes;
+			throughput.Add(it->m_rxBytes * 8 / m_binWidth);
+		}
+
+		results.AddMetric("Stats packets sent", total.m_txPackets);
+		results.AddMetric("Stats packets received", total.m_rxPackets);
+		results.AddMetric("Stats packets enqueued", total.m_enqueued);
+		results.AddMetric("Stats packets dropped", total.m_dropped);
+		results.AddMetric("Stats loss ratio", total.m_txPackets > 0 ? 100. * (total.m_txPackets - std::min(total.m_rxPackets, total.m_txPackets)) / total.m_txPackets : 0., "%");
+		results.AddMetric("Stats throughput p50", throughput.GetQuantile(0.5), " Bit/s");
+		results.AddMetric("Stats throughput p90", throughput.GetQuantile(0.9), " Bit/s");
+		results.AddMetric("Stats throughput p99", throughput.GetQuantile(0.99), " Bit/s");
+
+		// all 0 without samples, so every run has the same columns
+		results.AddMetric("Stats RTT samples", m_rtt.GetCount());
+		results.AddMetric("Stats RTT min", m_rtt.GetMin(), "us");
+		results.AddMetric("Stats RTT p50", m_rtt.GetQuantile(0.5), "us");
+		results.AddMetric("Stats RTT p90", m_rtt.GetQuantile(0.9), "us");
+		results.AddMetric("Stats RTT p99", m_rtt.GetQuantile(0.99), "us");
+		results.AddMetric("Stats RTT max", m_rtt.GetMax(), "us");
+
+		std::ofstream file(m_path.c_str());
+
+		if (!file) {
+			std::cerr << "Cannot write flow statistics to " << m_path << std::endl;
+			return false;
+		}
+
+		// one line per bin as loaded by Matlab's load(), the header is a comment
+		file << "% time\ttxPackets\ttxBytes\trxPackets\trxBytes\tenqueued\tdropped\tdroppedBytes" << std::endl;
+
+		for (size_t i = 0; i < m_bins.size(); i++) {
+			const Bin& bin = m_bins[i];
+			file << i * m_binWidth << "\t" << bin.m_txPackets << "\t" << bin.m_txBytes << "\t" << bin.m_rxPackets << "\t" << bin.m_rxBytes;
+			file << "\t" << bin.m_enqueued << "\t" << bin.m_dropped << "\t" << bin.m_droppedBytes << std::endl;
+		}
+
+		return file.good();
+	}
+
+private:
+	struct Bin {
+		Bin()
+			: m_txPackets(0)
+			, m_txBytes(0)
+			, m_rxPackets(0)
+			, m_rxBytes(0)
+			, m_enqueued(0)
+			, m_dropped(0)
+			, m_droppedBytes(0) {}
+
+		uint64_t	m_txPackets;
+		uint64_t	m_txBytes;
+		uint64_t	m_rxPackets;
+		uint64_t	m_rxBytes;
+		uint64_t	m_enqueued;
+		uint64_t	m_dropped;
+		uint64_t	m_droppedBytes;
+	};
+
+	/**
+	 * Bin of the current simulation time, the last bin also takes everything after the run length.
+	 */
+	Bin& GetBin(void) {
+		NS_ASSERT_MSG(!m_bins.empty(), "PakFlowStats::Init() has not been called");
+
+		size_t i = static_cast<size_t>(Simulator::Now().GetSeconds() / m_binWidth);
+
+		return m_bins[std::min(i, m_bins.size() - 1)];
+	}
+
+	std::string	m_path;
+	double		m_binWidth;
+	std::vector<Bin> m_bins;
+	PakHistogram	m_rtt;
+};
+
+} // namespace ns3
+
+#endif /* PAK_STATS_H */
@@ -9,6 +9,8 @@
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/int64x64-128.h"
 
+#include "../PAK-Common/pak-results.h"
+
 
 using namespace ns3;
 
@@ -26,13 +28,21 @@ int main(int argc, char* argv[]) {
 	bool limitQueue = false;
 	std::string tcpCong = "reno";
 
+	PakResults results("PAK-NSC-Reno");
+
 	CommandLine cmd;
 	cmd.AddValue("runtime", "Length in seconds to run this simulation", runtime);
 	cmd.AddValue("useNsc", "Enable if NSC shoukd be used as TCP stack for nodes A and B", useNsc);
 	cmd.AddValue("limitQueue", "Limit the bottleneck queue to 20 kB", limitQueue);
 	cmd.AddValue("tcpCong", "Congestion control algorithm", tcpCong);
+	results.AddOptions(cmd);
 	cmd.Parse(argc, argv);
 
+	results.SetParameter("runtime", runtime);
+	results.SetParameter("useNsc", useNsc);
+	results.SetParameter("limitQueue", limitQueue);
+	results.SetParameter("tcpCong", tcpCong);
+
 
 	NodeContainer nodes;
 	nodes.Create(3);
@@ -125,7 +135,9 @@ int main(int argc, char* argv[]) {
 
 
 	Simulator::Stop(Seconds(runtime + 60));
+	results.StartRun();
 	Simulator::Run();
+	results.StopRun();
 
 
 	flowMon.SerializeToXmlFile(filePath + ".flowmon", false, false);
@@ -133,12 +145,14 @@ int main(int argc, char* argv[]) {
 	Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinkApps.Get(0));
 
 	std::cout << std::endl;
-	std::cout << "Received bytes:\t" << sink->GetTotalRx() << std::endl;
+	results.AddMetric("Received bytes", sink->GetTotalRx());
 	std::cout << std::endl;
 
 
 	Simulator::Destroy();
 
+	results.Write();
+
 
 	return 0;
 }
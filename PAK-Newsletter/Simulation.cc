@@ -6,57 +6,178 @@
 #include "ns3/applications-module.h"
 #include "ns3/int64x64-128.h"
 
+#include "email-campaign-helper.h"
+#include "email-newsletter-application.h"
+#include "email-newsletter-helper.h"
+#include "email-server-application.h"
+#include "email-server-helper.h"
+#include "../PAK-Common/pak-results.h"
+#include "../PAK-Common/pak-pcap.h"
+#include "../PAK-Common/pak-stats.h"
+
+#include <algorithm>
+#include <ctime>
+#include <sys/resource.h>
+#include <vector>
+
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("PakNewsletter");
 
+static void CampaignCompleted(void) {
+	NS_LOG_INFO("Campaign completed at " << Simulator::Now().GetSeconds() << " s");
+	Simulator::Stop();
+}
+
 int main(int argc, char *argv[]) {
 	LogComponentEnable("PakNewsletter", LOG_LEVEL_INFO);
 
 	uint64_t nReceiversPerServer = 100;
 	uint64_t rtt = 50;
 	uint64_t nTcpConnections = 30;
+	uint32_t nRecipientsPerMail = 1;
+	bool pipelining = true;
+	uint32_t maxConnections = 0;
+	uint32_t maxConnectionsPerPeer = 0;
+	double greylist = 0;
 	uint32_t runtime = 300;
+	uint32_t nDestinations = 0;
+	std::string topology = "star";
+	uint32_t regions = 8;
+	uint64_t nRecipients = 100000;
+	double zipf = 1;
+	uint64_t rttMin = 10;
+	uint64_t rttMax = 300;
+	uint32_t maxSenderConnections = 0;
+
+	PakResults results("PAK-Newsletter");
+	PakPcap pcap("pak-newsletter");
+	PakFlowStats stats;
 
 	CommandLine cmd;
 	cmd.AddValue("rps", "Number of receivers per server", nReceiversPerServer);
-	cmd.AddValue("rtt", "RTT value", rtt);
+	cmd.AddValue("rtt", "Round trip time of the link in milliseconds", rtt);
 	cmd.AddValue("tcp-count", "Number of simultaneus TCP connections", nTcpConnections);
+	cmd.AddValue("rpm", "Number of recipients per mail transaction", nRecipientsPerMail);
+	cmd.AddValue("pipelining", "Pipeline the SMTP commands of a transaction", pipelining);
+	cmd.AddValue("max-conn", "Maximum number of SMTP sessions the mail server accepts, 0 for no limit", maxConnections);
+	cmd.AddValue("max-conn-per-peer", "Maximum number of SMTP sessions the mail server accepts from one address, 0 for no limit", maxConnectionsPerPeer);
+	cmd.AddValue("greylist", "Probability that the mail server greylists a new recipient", greylist);
 	cmd.AddValue("runtime", "Length in seconds to run this simulation", runtime);
+	cmd.AddValue("destinations", "Number of destination mail servers of a campaign, 0 for one server with an endless newsletter", nDestinations);
+	cmd.AddValue("topology", "Campaign network: star or tiered", topology);
+	cmd.AddValue("regions", "Number of regional routers of the tiered campaign network", regions);
+	cmd.AddValue("recipients", "Number of recipients of the campaign", nRecipients);
+	cmd.AddValue("zipf", "Exponent of the Zipf distribution of the campaign recipients over the destinations", zipf);
+	cmd.AddValue("rtt-min", "Minimum round trip time to a campaign destination in milliseconds", rttMin);
+	cmd.AddValue("rtt-max", "Maximum round trip time to a campaign destination in milliseconds", rttMax);
+	cmd.AddValue("sender-conn", "Maximum number of SMTP connections of the sender to all destinations, 0 for no limit", maxSenderConnections);
+	results.AddOptions(cmd);
+	pcap.AddOptions(cmd);
+	stats.AddOptions(cmd);
 	cmd.Parse(argc, argv);
 
+	// a campaign has two devices per destination, only trace the sender unless asked for more
+	if (nDestinations > 0) {
+		pcap.SetDefaultMode("nodes:0");
+	}
+
+	results.SetParameter("rps", nReceiversPerServer);
+	results.SetParameter("rtt", rtt);
+	results.SetParameter("tcp-count", nTcpConnections);
+	results.SetParameter("rpm", nRecipientsPerMail);
+	results.SetParameter("pipelining", pipelining);
+	results.SetParameter("max-conn", maxConnections);
+	results.SetParameter("max-conn-per-peer", maxConnectionsPerPeer);
+	results.SetParameter("greylist", greylist);
+	results.SetParameter("runtime", runtime);
+	results.SetParameter("destinations", nDestinations);
+
+	if (nDestinations > 0) {
+		results.SetParameter("topology", topology);
+		results.SetParameter("regions", regions);
+		results.SetParameter("recipients", nRecipients);
+		results.SetParameter("zipf", zipf);
+		results.SetParameter("rtt-min", rttMin);
+		results.SetParameter("rtt-max", rttMax);
+		results.SetParameter("sender-conn", maxSenderConnections);
+	}
+
+	results.SetParameter("pcap", pcap.GetMode());
+	results.SetParameter("pcapSnapLen", pcap.GetSnapLen());
+
 
 	PointToPointHelper p2p;
 	p2p.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
-	p2p.SetChannelAttribute("Delay", StringValue("50ms")); // TODO: dynamic RTT here
+	p2p.SetChannelAttribute("Delay", TimeValue(MicroSeconds(rtt * 500)));
+
+	Ptr<Node> sender;
+	NodeContainer serverNodes;
+	Address remote;
+	EmailCampaignHelper campaign;
+
+	if (nDestinations == 0) {
+		NodeContainer nodes;
+		nodes.Create(2);
 
 
-	NodeContainer nodes;
-	nodes.Create(2);
+		NetDeviceContainer devices;
+		devices = p2p.Install(nodes);
 
 
-	NetDeviceContainer devices;
-	devices = p2p.Install(nodes);
+		InternetStackHelper stack;
+		stack.Install(nodes);
 
 
-	InternetStackHelper stack;
-	stack.Install(nodes);
+		Ipv4AddressHelper address;
+		address.SetBase("10.1.1.0", "255.255.255.0");
 
+		Ipv4InterfaceContainer interfaces = address.Assign(devices);
+
+		sender = nodes.Get(0);
+		serverNodes.Add(nodes.Get(1));
+		remote = InetSocketAddress(interfaces.GetAddress(1), 2048);
+	}
+	else {
+		// the sender is created first and is node 0, the default --pcap=nodes:0 traces its uplink
+		campaign.SetTopology(topology);
+		campaign.SetRegions(regions);
+		campaign.SetRttRange(MilliSeconds(rttMin), MilliSeconds(rttMax));
+		campaign.Create(nDestinations);
+
+		sender = campaign.GetSender();
+		serverNodes = campaign.GetDestinations();
+	}
 
-	Ipv4AddressHelper address;
-	address.SetBase("10.1.1.0", "255.255.255.0");
 
-	Ipv4InterfaceContainer interfaces = address.Assign(devices);
+	EmailNewsletterHelper enHelper("ns3::TcpSocketFactory", remote);
+	enHelper.SetAttribute("ReceiverPerServer", UintegerValue(nReceiversPerServer));
+	enHelper.SetAttribute("RecipientsPerMail", UintegerValue(nRecipientsPerMail));
+	enHelper.SetAttribute("Pipelining", BooleanValue(pipelining));
+	enHelper.SetAttribute("MaxConnectionsPerDestination", UintegerValue(nTcpConnections));
+	enHelper.SetAttribute("MaxConnections", UintegerValue(maxSenderConnections));
 
+	EmailServerHelper sinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), 2048));
+	sinkHelper.SetAttribute("MaxConnections", UintegerValue(maxConnections));
+	sinkHelper.SetAttribute("MaxConnectionsPerPeer", UintegerValue(maxConnectionsPerPeer));
+	sinkHelper.SetAttribute("GreylistProbability", DoubleValue(greylist));
+	ApplicationContainer sink = sinkHelper.Install(serverNodes);
 
-	EmailNewsletterHelper enHelper("ns3::TcpSocketFactory", InetSocketAddress(interfaces.GetAddress(1), 2048));
-	ApplicationContainer enServerApps;
+	// one application per node, it pools its connections
+	ApplicationContainer enServerApps = enHelper.Install(sender);
+	Ptr<EmailNewsletterApplication> newsletter = DynamicCast<EmailNewsletterApplication>(enServerApps.Get(0));
 
-	PacketSinkHelper sinkHelper("ns3::TcpSocketFactory", InetSocketAddress(interfaces.GetAddress(1), 2048));
-	ApplicationContainer sink = sinkHelper.Install(nodes.Get(1));
+	if (nDestinations > 0) {
+		std::vector<uint64_t> shares = EmailCampaignHelper::DistributeRecipients(nRecipients, nDestinations, zipf);
 
-	for (uint32_t i = 0; i < nTcpConnections; ++i) {
-		enServerApps.Add(enHelper.Install(nodes.Get(0)));
+		// a destination without recipients would get an endless newsletter
+		for (uint32_t i = 0; i < nDestinations; i++) {
+			if (shares[i] > 0) {
+				newsletter->AddDestination(InetSocketAddress(campaign.GetDestinationAddress(i), 2048), shares[i]);
+			}
+		}
+
+		newsletter->TraceConnectWithoutContext("Completed", MakeCallback(&CampaignCompleted));
 	}
 
 
@@ -67,13 +188,102 @@ int main(int argc, char *argv[]) {
 	enServerApps.Stop(Seconds(runtime));
 
 
-	p2p.EnablePcapAll("pak-newsletter");
+	pcap.Enable(p2p);
+
+	if (stats.IsEnabled()) {
+		stats.Init(Seconds(runtime));
+
+		for (uint32_t i = 0; i < enServerApps.GetN(); ++i) {
+			enServerApps.Get(i)->TraceConnectWithoutContext("Tx", MakeCallback(&PakFlowStats::Tx, &stats));
+		}
+
+		for (uint32_t i = 0; i < sink.GetN(); ++i) {
+			sink.Get(i)->TraceConnectWithoutContext("Rx", MakeCallback(&PakFlowStats::Rx, &stats));
+		}
+	}
 
 
 	Simulator::Stop(Seconds(runtime));
+	std::clock_t cpuStart = std::clock();
+	results.StartRun();
 	Simulator::Run();
+	results.StopRun();
+	double cpuTime = (std::clock() - cpuStart) / static_cast<double>(CLOCKS_PER_SEC);
+
+	uint64_t mails = 0;
+	uint64_t recipients = 0;
+	uint64_t rejected = 0;
+	uint64_t deferred = 0;
+	uint64_t connections = 0;
+	uint64_t reused = 0;
+	uint32_t peakConnections = 0;
+	Time deliveryTime;
+	for (uint32_t i = 0; i < enServerApps.GetN(); ++i) {
+		Ptr<EmailNewsletterApplication> app = DynamicCast<EmailNewsletterApplication>(enServerApps.Get(i));
+		mails += app->GetTotalMails();
+		recipients += app->GetTotalRecipients();
+		rejected += app->GetRejectedRecipients();
+		deferred += app->GetDeferredRecipients();
+		connections += app->GetTotalConnections();
+		reused += app->GetReusedTransactions();
+		peakConnections += app->GetMaxOpenConnections();
+		deliveryTime += app->GetTotalDeliveryTime();
+	}
+
+	// kilobytes on Linux
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	uint64_t rxBytes = 0;
+	uint64_t uniqueRecipients = 0;
+	uint64_t duplicateRecipients = 0;
+	uint64_t greylisted = 0;
+	uint64_t refused = 0;
+	uint32_t peakSessions = 0;
+	for (uint32_t i = 0; i < sink.GetN(); ++i) {
+		Ptr<EmailServerApplication> server = DynamicCast<EmailServerApplication>(sink.Get(i));
+		rxBytes += server->GetTotalRx();
+		uniqueRecipients += server->GetUniqueRecipients();
+		duplicateRecipients += server->GetDuplicateRecipients();
+		greylisted += server->GetGreylistedRecipients();
+		refused += server->GetRefusedConnections();
+		peakSessions = std::max(peakSessions, server->GetMaxSessions());
+	}
+
+	// the newsletter applications start after 10 s, a campaign ends with its last recipient
+	Time completion = newsletter->GetCompletionTime();
+	double sendingTime = completion.IsZero() ? runtime - 10. : completion.GetSeconds() - 10;
+
+	results.AddMetric("Received bytes", rxBytes);
+	results.AddMetric("Mails sent", mails);
+	results.AddMetric("Recipients delivered", recipients);
+	results.AddMetric("Unique recipients delivered", uniqueRecipients);
+	results.AddMetric("Duplicate recipients delivered", duplicateRecipients);
+	results.AddMetric("Recipients rejected", rejected);
+	results.AddMetric("Recipients deferred", deferred);
+	results.AddMetric("Recipients greylisted", greylisted);
+	results.AddMetric("SMTP connections", connections);
+	results.AddMetric("Transactions on reused connections", reused);
+	results.AddMetric("Peak open SMTP connections", peakConnections);
+	results.AddMetric("SMTP connections refused", refused);
+	results.AddMetric("Peak SMTP sessions", peakSessions);
+	results.AddMetric("Mean mail delivery time", (mails > 0 ? deliveryTime.GetSeconds() * 1e3 / mails : 0.), "ms");
+	results.AddMetric("Recipients per hour", (sendingTime > 0 ? recipients * 3600. / sendingTime : 0.));
+
+	// also without a campaign, so every run has the same columns
+	results.AddMetric("Campaign completed", !completion.IsZero());
+	results.AddMetric("Campaign completion time", (completion.IsZero() ? 0. : sendingTime), "s");
+	results.AddMetric("Campaign goodput", (sendingTime > 0 ? rxBytes * 8. / sendingTime : 0.), " Bit/s");
+
+	results.AddMetric("Simulation CPU time", cpuTime, "s");
+	results.AddMetric("CPU time per mail", (mails > 0 ? cpuTime * 1e6 / mails : 0.), "us");
+	results.AddMetric("Peak resident set size", static_cast<int64_t>(usage.ru_maxrss), " KiB");
+	stats.Write(results);
+
 	Simulator::Destroy();
 
+	results.Write();
+
 
 	return 0;
 }
@@ -0,0 +1,215 @@
+#include "email-campaign-helper.h"
+#include "ns3/fatal-error.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/string.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace ns3 {
+
+EmailCampaignHelper::EmailCampaignHelper()
+	: m_topology("star")
+	, m_regions(8)
+	, m_minRtt(MilliSeconds(10))
+	, m_maxRtt(MilliSeconds(300))
+	, m_uplinkDataRate("1Gbps")
+	, m_uplinkDelay(MilliSeconds(1))
+	, m_backboneDataRate("10Gbps")
+	, m_backboneDelay(MilliSeconds(2))
+	, m_accessDataRate("100Mbps") {}
+
+void EmailCampaignHelper::SetTopology(std::string topology) {
+	m_topology = topology;
+}
+
+void EmailCampaignHelper::SetRegions(uint32_t regions) {
+	m_regions = regions;
+}
+
+void EmailCampaignHelper::SetRttRange(Time min, Time max) {
+	m_minRtt = min;
+	m_maxRtt = max;
+}
+
+void EmailCampaignHelper::SetUplink(std::string dataRate, Time delay) {
+	m_uplinkDataRate = dataRate;
+	m_uplinkDelay = delay;
+}
+
+void EmailCampaignHelper::SetBackbone(std::string dataRate, Time delay) {
+	m_backboneDataRate = dataRate;
+	m_backboneDelay = delay;
+}
+
+void EmailCampaignHelper::SetAccessDataRate(std::string dataRate) {
+	m_accessDataRate = dataRate;
+}
+
+void EmailCampaignHelper::Create(uint32_t destinations) {
+	bool tiered = m_topology == "tiered";
+
+	if (!tiered && m_topology != "star") {
+		NS_FATAL_ERROR("Invalid campaign topology " << m_topology << ", expected star or tiered");
+	}
+
+	// a region gets 10.<region + 1>.0.0/16, the star all of 10.0.0.0/8, cut into /30 links
+	uint32_t regions = tiered ? m_regions : 1;
+
+	if (regions == 0 || regions > 254) {
+		NS_FATAL_ERROR("The tiered campaign topology needs 1 to 254 regions, not " << regions);
+	}
+
+	if ((destinations + regions - 1) / regions > (tiered ? 1u << 14 : 1u << 22)) {
+		NS_FATAL_ERROR("Too many destinations per region: " << destinations << " in " << regions);
+	}
+
+	if (m_minRtt > m_maxRtt) {
+		NS_FATAL_ERROR("The minimum RTT of the campaign is larger than the maximum");
+	}
+
+	m_sender = CreateObject<Node>();
+	m_routers.Create(tiered ? regions + 1 : 1);
+	m_destinations.Create(destinations);
+
+	InternetStackHelper stack;
+	stack.Install(m_sender);
+	stack.Install(m_routers);
+	stack.Install(m_destinations);
+
+	Ptr<Node> core = m_routers.Get(0);
+	Ipv4AddressHelper address;
+	address.SetBase("192.168.0.0", "255.255.255.252");
+
+	NetDeviceContainer uplink = Connect(core, m_sender, m_uplinkDataRate, m_uplinkDelay);
+	Ipv4InterfaceContainer uplinkInterfaces = address.Assign(uplink);
+	SetDefaultRoute(m_sender, uplink.Get(1), uplinkInterfaces.GetAddress(0));
+
+	std::vector<Ipv4AddressHelper> regionAddress(regions);
+	Time fixed = m_uplinkDelay;
+
+	if (tiered) {
+		Ipv4StaticRoutingHelper routing;
+		Ptr<Ipv4> coreIpv4 = core->GetObject<Ipv4>();
+		Ptr<Ipv4StaticRouting> coreRouting = routing.GetStaticRouting(coreIpv4);
+		address.SetBase("172.16.0.0", "255.255.255.252");
+		fixed += m_backboneDelay;
+
+		for (uint32_t r = 0; r < regions; r++) {
+			Ptr<Node> router = m_routers.Get(r + 1);
+			NetDeviceContainer link = Connect(core, router, m_backboneDataRate, m_backboneDelay);
+			Ipv4InterfaceContainer interfaces = address.Assign(link);
+			address.NewNetwork();
+
+			Ipv4Address prefix((10 << 24) | ((r + 1) << 16));
+			coreRouting->AddNetworkRouteTo(prefix, Ipv4Mask("255.255.0.0"), interfaces.GetAddress(1), coreIpv4->GetInterfaceForDevice(link.Get(0)));
+			SetDefaultRoute(router, link.Get(1), interfaces.GetAddress(0));
+			regionAddress[r].SetBase(prefix, Ipv4Mask("255.255.255.252"));
+		}
+	}
+	else {
+		regionAddress[0].SetBase("10.0.0.0", "255.255.255.252");
+	}
+
+	Ptr<UniformRandomVariable> rtt = CreateObject<UniformRandomVariable>();
+	m_addresses.clear();
+	m_rtts.clear();
+
+	for (uint32_t i = 0; i < destinations; i++) {
+		uint32_t region = i % regions;
+		Ptr<Node> server = m_destinations.Get(i);
+
+		// the access link makes up the part of the path not taken by the shared links
+		Time path = Seconds(rtt->GetValue(m_minRtt.GetSeconds(), m_maxRtt.GetSeconds()) / 2);
+		Time access = path > fixed ? path - fixed : Seconds(0);
+
+		NetDeviceContainer link = Connect(m_routers.Get(tiered ? region + 1 : 0), server, m_accessDataRate, access);
+		Ipv4InterfaceContainer interfaces = regionAddress[region].Assign(link);
+		regionAddress[region].NewNetwork();
+		SetDefaultRoute(server, link.Get(1), interfaces.GetAddress(0));
+
+		m_addresses.push_back(interfaces.GetAddress(1));
+		m_rtts.push_back(fixed + access + fixed + access);
+	}
+}
+
+Ptr<Node> EmailCampaignHelper::GetSender(void) const {
+	return m_sender;
+}
+
+NodeContainer EmailCampaignHelper::GetDestinations(void) const {
+	return m_destinations;
+}
+
+Ipv4Address EmailCampaignHelper::GetDestinationAddress(uint32_t i) const {
+	return m_addresses.at(i);
+}
+
+Time EmailCampaignHelper::GetDestinationRtt(uint32_t i) const {
+	return m_rtts.at(i);
+}
+
+/**
+ * Larger remainder first, the larger destination on a tie.
+ */
+static bool CompareRemainders(const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b) {
+	return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+std::vector<uint64_t> EmailCampaignHelper::DistributeRecipients(uint64_t recipients, uint32_t destinations, double exponent) {
+	std::vector<uint64_t> shares(destinations, 0);
+
+	if (destinations == 0) {
+		return shares;
+	}
+
+	std::vector<double> weights(destinations);
+	double total = 0;
+
+	for (uint32_t i = 0; i < destinations; i++) {
+		weights[i] = std::pow(i + 1., -exponent);
+		total += weights[i];
+	}
+
+	std::vector<std::pair<double, uint32_t> > remainders(destinations);
+	uint64_t assigned = 0;
+
+	for (uint32_t i = 0; i < destinations; i++) {
+		double quota = recipients * weights[i] / total;
+		shares[i] = std::min<uint64_t>(std::floor(quota), recipients - assigned);
+		assigned += shares[i];
+		remainders[i] = std::make_pair(quota - shares[i], i);
+	}
+
+	std::sort(remainders.begin(), remainders.end(), CompareRemainders);
+
+	for (uint64_t i = 0; assigned < recipients; i++) {
+		shares[remainders[i % destinations].second]++;
+		assigned++;
+	}
+
+	return shares;
+}
+
+NetDeviceContainer EmailCampaignHelper::Connect(Ptr<Node> router, Ptr<Node> node, std::string dataRate, Time delay) {
+	PointToPointHelper p2p;
+	p2p.SetDeviceAttribute("DataRate", StringValue(dataRate));
+	p2p.SetChannelAttribute("Delay", TimeValue(delay));
+
+	return p2p.Install(router, node);
+}
+
+void EmailCampaignHelper::SetDefaultRoute(Ptr<Node> node, Ptr<NetDevice> device, Ipv4Address gateway) {
+	Ipv4StaticRoutingHelper routing;
+	Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+
+	routing.GetStaticRouting(ipv4)->SetDefaultRoute(gateway, ipv4->GetInterfaceForDevice(device));
+}
+
+} // namespace ns3
@@ -0,0 +1,84 @@
+#ifndef EMAIL_CAMPAIGN_HELPER_H
+#define EMAIL_CAMPAIGN_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ns3/ipv4-address.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * Builds the network of a newsletter campaign: one sender node and many
+ * destination mail servers, each behind its own access link.
+ *
+ * The "star" topology connects the sender to a hub all servers hang off,
+ * "tiered" connects it to a core router with Regions regional routers
+ * below it that share the servers round robin. The access link delays are
+ * chosen so the round trip times from the sender are spread uniformly
+ * between the minimum and maximum RTT.
+ *
+ * Routes are set statically along the tree, the global routing helper
+ * would need time and memory quadratic in the number of nodes.
+ */
+class EmailCampaignHelper {
+public:
+	EmailCampaignHelper();
+
+	/**
+	 * "star" or "tiered".
+	 */
+	void SetTopology(std::string topology);
+	void SetRegions(uint32_t regions);
+	void SetRttRange(Time min, Time max);
+	void SetUplink(std::string dataRate, Time delay);
+	void SetBackbone(std::string dataRate, Time delay);
+	void SetAccessDataRate(std::string dataRate);
+
+	/**
+	 * Creates the nodes, links, internet stacks, addresses and routes.
+	 */
+	void Create(uint32_t destinations);
+
+	Ptr<Node> GetSender(void) const;
+	NodeContainer GetDestinations(void) const;
+	Ipv4Address GetDestinationAddress(uint32_t i) const;
+	Time GetDestinationRtt(uint32_t i) const;
+
+	/**
+	 * Splits recipients among destinations by Zipf's law: destination i gets
+	 * a share proportional to 1 / (i + 1)^exponent. The shares are rounded by
+	 * largest remainder, so they add up to recipients exactly.
+	 */
+	static std::vector<uint64_t> DistributeRecipients(uint64_t recipients, uint32_t destinations, double exponent);
+
+private:
+	/**
+	 * Connects a new link from router to node and returns its devices, router first.
+	 */
+	NetDeviceContainer Connect(Ptr<Node> router, Ptr<Node> node, std::string dataRate, Time delay);
+	static void SetDefaultRoute(Ptr<Node> node, Ptr<NetDevice> device, Ipv4Address gateway);
+
+	std::string	m_topology;
+	uint32_t	m_regions;
+	Time		m_minRtt;
+	Time		m_maxRtt;
+	std::string	m_uplinkDataRate;
+	Time		m_uplinkDelay;
+	std::string	m_backboneDataRate;
+	Time		m_backboneDelay;
+	std::string	m_accessDataRate;
+
+	Ptr<Node>	m_sender;
+	NodeContainer	m_routers;
+	NodeContainer	m_destinations;
+	std::vector<Ipv4Address> m_addresses;
+	std::vector<Time> m_rtts;
+};
+
+} // namespace ns3
+
+#endif /* EMAIL_CAMPAIGN_HELPER_H */
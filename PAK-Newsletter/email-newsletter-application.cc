@@ -20,6 +20,7 @@
 
 #include "ns3/log.h"
 #include "ns3/address.h"
+#include "ns3/boolean.h"
 #include "ns3/node.h"
 #include "ns3/nstime.h"
 #include "ns3/socket.h"
@@ -31,11 +32,444 @@
 #include "ns3/tcp-socket-factory.h"
 #include "email-newsletter-application.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("EmailNewsletterApplication");
 NS_OBJECT_ENSURE_REGISTERED(EmailNewsletterApplication);
 
+EmailNewsletterSession::EmailNewsletterSession(EmailNewsletterApplication* app, uint32_t destination)
+	: m_app(app)
+	, m_destination(destination)
+	, m_socket(0)
+	, m_connected(false)
+	, m_ready(false)
+	, m_idle(false)
+	, m_serverPipelining(false)
+	, m_sendingData(false)
+	, m_offset(0)
+	, m_sentRecipients(0)
+	, m_mails(0) {
+	NS_LOG_FUNCTION(this << destination);
+}
+
+bool EmailNewsletterSession::IsIdle(void) const {
+	return m_idle;
+}
+
+bool EmailNewsletterSession::IsConnecting(void) const {
+	return m_socket && !m_ready;
+}
+
+uint32_t EmailNewsletterSession::GetDestination(void) const {
+	return m_destination;
+}
+
+void EmailNewsletterSession::Connect(void) {
+	NS_LOG_FUNCTION(this);
+
+	const Address& peer = m_app->m_destinations[m_destination].m_address;
+	m_socket = Socket::CreateSocket(m_app->GetNode(), m_app->m_tid);
+
+	if (m_socket->GetSocketType() != Socket::NS3_SOCK_STREAM && m_socket->GetSocketType() != Socket::NS3_SOCK_SEQPACKET) {
+		NS_FATAL_ERROR("Using EmailNewsletter with an incompatible socket type. "
+			"EmailNewsletter requires SOCK_STREAM or SOCK_SEQPACKET. "
+			"In other words, use TCP instead of UDP.");
+	}
+
+	if (Inet6SocketAddress::IsMatchingType(peer)) {
+		m_socket->Bind6();
+	}
+	else if (InetSocketAddress::IsMatchingType(peer)) {
+		m_socket->Bind();
+	}
+
+	m_socket->Connect(peer);
+	m_socket->SetConnectCallback(
+		MakeCallback(&EmailNewsletterSession::ConnectionSucceeded, this),
+		MakeCallback(&EmailNewsletterSession::ConnectionFailed, this)
+	);
+	m_socket->SetSendCallback(MakeCallback(&EmailNewsletterSession::BufferAvailableCb, this));
+	m_socket->SetRecvCallback(MakeCallback(&EmailNewsletterSession::HandleRead, this));
+	m_socket->SetCloseCallbacks(
+		MakeCallback(&EmailNewsletterSession::HandlePeerClose, this),
+		MakeCallback(&EmailNewsletterSession::HandlePeerClose, this)
+	);
+
+	// the server speaks first
+	m_awaiting.push_back(SMTP_GREETING);
+}
+
+void EmailNewsletterSession::Close(void) {
+	NS_LOG_FUNCTION(this);
+
+	Simulator::Cancel(m_idleEvent);
+
+	if (m_socket) {
+		// the socket may outlive this session
+		m_socket->SetConnectCallback(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+		m_socket->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+		m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+		m_socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket> >(), MakeNullCallback<void, Ptr<Socket> >());
+		m_socket->Close();
+		m_socket = 0;
+	}
+
+	m_connected = false;
+	m_ready = false;
+	m_idle = false;
+}
+
+void EmailNewsletterSession::Abort(void) {
+	NS_LOG_FUNCTION(this);
+
+	Ptr<EmailNewsletterSession> self = this;
+
+	for (std::vector<uint64_t>::const_iterator it = m_acceptedRcpts.begin(); it != m_acceptedRcpts.end(); ++it) {
+		m_app->Defer(m_destination, *it);
+	}
+
+	for (std::deque<uint64_t>::const_iterator it = m_mailRcpts.begin(); it != m_mailRcpts.end(); ++it) {
+		m_app->Defer(m_destination, *it);
+	}
+
+	m_acceptedRcpts.clear();
+	m_mailRcpts.clear();
+	Close();
+	m_app->SessionClosed(self);
+}
+
+void EmailNewsletterSession::Wake(void) {
+	NS_LOG_FUNCTION(this);
+
+	if (!m_idle) {
+		return;
+	}
+
+	Simulator::Cancel(m_idleEvent);
+	m_idle = false;
+
+	SendMail();
+	SendEnvelope();
+	SendRemaining();
+}
+
+void EmailNewsletterSession::IdleTimeout(void) {
+	NS_LOG_FUNCTION(this);
+
+	m_idle = false;
+	SendCommand(SMTP_QUIT, "QUIT");
+}
+
+void EmailNewsletterSession::ConnectionSucceeded(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+	NS_LOG_LOGIC("EmailNewsletterSession Connection succeeded");
+
+	m_connected = true;
+	m_app->m_totalConnections++;
+}
+
+void EmailNewsletterSession::ConnectionFailed(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+	NS_LOG_LOGIC("EmailNewsletterSession, Connection Failed");
+
+	m_app->Backoff(m_destination);
+	Abort();
+}
+
+void EmailNewsletterSession::HandlePeerClose(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+
+	Abort();
+}
+
+void EmailNewsletterSession::HandleRead(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+
+	Ptr<EmailNewsletterSession> self = this;
+	Ptr<Packet> packet;
+
+	while ((packet = socket->Recv())) {
+		if (packet->GetSize() == 0) {
+			break;
+		}
+
+		std::vector<uint8_t> data(packet->GetSize());
+		packet->CopyData(&data[0], data.size());
+		m_rxBuffer.append(data.begin(), data.end());
+	}
+
+	// HandleReply() may close the session
+	std::string::size_type end;
+
+	while (m_socket == socket && (end = m_rxBuffer.find("\r\n")) != std::string::npos) {
+		std::string line = m_rxBuffer.substr(0, end);
+		m_rxBuffer.erase(0, end + 2);
+
+		if (!m_awaiting.empty() && m_awaiting.front() == SMTP_EHLO && line.find("PIPELINING") != std::string::npos) {
+			m_serverPipelining = true;
+		}
+
+		// "250-..." continues a multiline reply, "250 ..." ends it
+		if (line.size() < 4 || line[3] != '-') {
+			HandleReply(std::atoi(line.substr(0, 3).c_str()), line.size() > 4 ? line.substr(4) : "");
+		}
+	}
+}
+
+void EmailNewsletterSession::HandleReply(uint32_t code, const std::string& text) {
+	NS_LOG_FUNCTION(this << code << text);
+
+	if (m_awaiting.empty()) {
+		NS_LOG_WARN("EmailNewsletterSession received an unexpected reply " << code << " " << text);
+		return;
+	}
+
+	SmtpCommand command = m_awaiting.front();
+	m_awaiting.pop_front();
+
+	// the server closes the connection, try the open recipients again later
+	if (code == 421) {
+		m_app->Backoff(m_destination);
+		Abort();
+		return;
+	}
+
+	switch (command) {
+	case SMTP_GREETING:
+		if (code == 220) {
+			SendCommand(SMTP_EHLO, "EHLO newsletter.example.com");
+		}
+		else {
+			SendCommand(SMTP_QUIT, "QUIT");
+		}
+		break;
+
+	case SMTP_EHLO:
+		if (code == 250) {
+			m_ready = true;
+			SendMail();
+		}
+		else {
+			SendCommand(SMTP_QUIT, "QUIT");
+		}
+		break;
+
+	case SMTP_MAIL:
+		if (code != 250) {
+			NS_LOG_LOGIC("MAIL FROM rejected with " << code);
+		}
+		break;
+
+	case SMTP_RCPT:
+		if (code == 250 || code == 251) {
+			m_acceptedRcpts.push_back(m_mailRcpts.front());
+		}
+		else if (code >= 400 && code < 500) {
+			m_app->Defer(m_destination, m_mailRcpts.front());
+		}
+		else {
+			m_app->Rejected(m_destination, 1);
+		}
+
+		m_mailRcpts.pop_front();
+		break;
+
+	case SMTP_DATA:
+		if (code == 354) {
+			m_sendingData = true;
+			m_offset = 0;
+		}
+		else {
+			// usually no recipient was accepted, but a refused DATA also ends the transaction for those that were
+			if (code >= 400 && code < 500) {
+				for (std::vector<uint64_t>::const_iterator it = m_acceptedRcpts.begin(); it != m_acceptedRcpts.end(); ++it) {
+					m_app->Defer(m_destination, *it);
+				}
+			}
+			else if (!m_acceptedRcpts.empty()) {
+				m_app->Rejected(m_destination, m_acceptedRcpts.size());
+			}
+
+			m_acceptedRcpts.clear();
+			SendCommand(SMTP_RSET, "RSET");
+		}
+		break;
+
+	case SMTP_DATA_END:
+		if (code == 250) {
+			m_app->Delivered(m_destination, m_acceptedRcpts.size(), Simulator::Now() - m_mailStart);
+		}
+		else if (code >= 400 && code < 500) {
+			for (std::vector<uint64_t>::const_iterator it = m_acceptedRcpts.begin(); it != m_acceptedRcpts.end(); ++it) {
+				m_app->Defer(m_destination, *it);
+			}
+		}
+		else {
+			m_app->Rejected(m_destination, m_acceptedRcpts.size());
+		}
+
+		m_acceptedRcpts.clear();
+		SendMail();
+		break;
+
+	case SMTP_RSET:
+		SendMail();
+		break;
+
+	case SMTP_QUIT:
+		{
+			Ptr<EmailNewsletterSession> self = this;
+			Close();
+			m_app->SessionClosed(self);
+		}
+		return;
+	}
+
+	SendEnvelope();
+	SendRemaining();
+}
+
+void EmailNewsletterSession::SendCommand(SmtpCommand command, const std::string& line) {
+	NS_LOG_FUNCTION(this << line);
+
+	m_txBuffer += line + "\r\n";
+	m_awaiting.push_back(command);
+	SendRemaining();
+}
+
+void EmailNewsletterSession::SendEnvelope(void) {
+	NS_LOG_FUNCTION(this);
+
+	bool pipelining = m_app->m_pipelining && m_serverPipelining;
+
+	// without pipelining every command waits for the reply to the previous one
+	while (!m_envelope.empty() && (pipelining || m_awaiting.empty())) {
+		m_txBuffer += m_envelope.front().second + "\r\n";
+		m_awaiting.push_back(m_envelope.front().first);
+		m_envelope.pop_front();
+	}
+}
+
+void EmailNewsletterSession::SendMail(void) {
+	NS_LOG_FUNCTION(this);
+
+	uint32_t receiverPerServer = m_app->m_receiverPerServer;
+
+	if (m_sentRecipients >= receiverPerServer) {
+		SendCommand(SMTP_QUIT, "QUIT");
+		return;
+	}
+
+	m_mailRcpts.clear();
+	m_app->TakeRecipients(m_destination, std::min(m_app->m_recipientsPerMail, receiverPerServer - m_sentRecipients), m_mailRcpts);
+
+	// a finished destination will not get new work, and an idle connection takes a slot others wait for
+	if (m_mailRcpts.empty() && (m_app->IsFinished(m_app->m_destinations[m_destination]) || !m_app->m_waiting.empty())) {
+		SendCommand(SMTP_QUIT, "QUIT");
+		return;
+	}
+
+	// keep the connection for work arriving within IdleTimeout
+	if (m_mailRcpts.empty()) {
+		m_idle = true;
+		m_idleEvent = Simulator::Schedule(m_app->m_idleTimeout, &EmailNewsletterSession::IdleTimeout, this);
+		return;
+	}
+
+	if (m_mails > 0) {
+		m_app->m_reusedTransactions++;
+	}
+
+	std::ostringstream mail;
+	mail << "MAIL FROM:<newsletter@example.com> SIZE=" << m_app->m_sendSize;
+
+	m_mails++;
+	m_mailStart = Simulator::Now();
+	m_acceptedRcpts.clear();
+	m_sentRecipients += m_mailRcpts.size();
+	m_envelope.push_back(std::make_pair(SMTP_MAIL, mail.str()));
+
+	for (std::deque<uint64_t>::const_iterator it = m_mailRcpts.begin(); it != m_mailRcpts.end(); ++it) {
+		std::ostringstream rcpt;
+		rcpt << "RCPT TO:<recipient" << *it << "@domain" << m_destination << ".example.net>";
+		m_envelope.push_back(std::make_pair(SMTP_RCPT, rcpt.str()));
+	}
+
+	// DATA ends a pipelined batch, the body has to wait for 354 anyway
+	m_envelope.push_back(std::make_pair(SMTP_DATA, std::string("DATA")));
+}
+
+void EmailNewsletterSession::SendRemaining(void) {
+	NS_LOG_FUNCTION(this);
+
+	if (!m_connected) {
+		return;
+	}
+
+	// TCP refuses a packet larger than its free buffer, so only hand over
+	// what fits and continue once BufferAvailableCb fires
+	while (!m_txBuffer.empty()) {
+		uint32_t toSend = std::min<uint32_t>(m_txBuffer.size(), m_socket->GetTxAvailable());
+
+		if (toSend == 0) {
+			return;
+		}
+
+		Ptr<Packet> packet = Create<Packet>(reinterpret_cast<const uint8_t*>(m_txBuffer.data()), toSend);
+		int actual = m_socket->Send(packet);
+
+		if (actual <= 0) {
+			return;
+		}
+
+		m_app->m_txTrace(packet);
+		m_txBuffer.erase(0, actual);
+	}
+
+	if (!m_sendingData) {
+		return;
+	}
+
+	NS_LOG_LOGIC("sending mail body at " << Simulator::Now());
+
+	uint32_t sendSize = m_app->m_sendSize;
+
+	while (m_offset < sendSize) {
+		uint32_t toSend = std::min(sendSize - m_offset, m_socket->GetTxAvailable());
+
+		if (toSend == 0) {
+			return;
+		}
+
+		Ptr<Packet> packet = m_app->m_payload->CreateFragment(m_offset, toSend);
+		int actual = m_socket->Send(packet);
+
+		if (actual <= 0) {
+			return;
+		}
+
+		m_app->m_txTrace(packet);
+		m_offset += actual;
+	}
+
+	// the body's last CRLF is part of the terminator
+	m_sendingData = false;
+	m_txBuffer += "\r\n.";
+	SendCommand(SMTP_DATA_END, "");
+}
+
+void EmailNewsletterSession::BufferAvailableCb(Ptr<Socket>, uint32_t) {
+	NS_LOG_FUNCTION(this);
+
+	SendRemaining();
+}
+
+
 TypeId EmailNewsletterApplication::GetTypeId(void) {
 	static TypeId tid = TypeId("ns3::EmailNewsletterApplication")
 		.SetParent<Application>()
@@ -49,33 +483,74 @@ TypeId EmailNewsletterApplication::GetTypeId(void) {
 			AddressValue(),
 			MakeAddressAccessor(&EmailNewsletterApplication::m_peer),
 			MakeAddressChecker())
-		.AddAttribute("Rtt", "The RTT delay value in milli seconds.",
-			UintegerValue(50),
-			MakeUintegerAccessor(&EmailNewsletterApplication::m_rtt),
+		.AddAttribute("Recipients", "The number of recipients at Remote, 0 for an endless newsletter.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&EmailNewsletterApplication::m_peerRecipients),
 			MakeUintegerChecker<uint64_t>())
-		.AddAttribute("ReceiverPerServer", "The number of mail receivers per mail server.",
+		.AddAttribute("ReceiverPerServer", "The number of mail receivers per connection to a mail server.",
 			UintegerValue(100),
-			MakeUintegerAccessor(&EmailNewsletterApplication::m_rtt),
+			MakeUintegerAccessor(&EmailNewsletterApplication::m_receiverPerServer),
+			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("RecipientsPerMail", "The number of RCPT commands per mail transaction.",
+			UintegerValue(1),
+			MakeUintegerAccessor(&EmailNewsletterApplication::m_recipientsPerMail),
 			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("Pipelining", "Send the commands of a transaction in one batch if the server offers PIPELINING.",
+			BooleanValue(true),
+			MakeBooleanAccessor(&EmailNewsletterApplication::m_pipelining),
+			MakeBooleanChecker())
+		.AddAttribute("MaxConnectionsPerDestination", "The number of connections to one mail server open at the same time.",
+			UintegerValue(1),
+			MakeUintegerAccessor(&EmailNewsletterApplication::m_maxConnectionsPerDestination),
+			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("MaxConnections", "The number of connections to all mail servers open at the same time, 0 for no limit.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&EmailNewsletterApplication::m_maxConnections),
+			MakeUintegerChecker<uint32_t>())
+		.AddAttribute("IdleTimeout", "Time a connection without work is kept open.",
+			TimeValue(Seconds(10)),
+			MakeTimeAccessor(&EmailNewsletterApplication::m_idleTimeout),
+			MakeTimeChecker())
+		.AddAttribute("RetryDelay", "Time before a deferred recipient or a refusing server is tried again.",
+			TimeValue(Seconds(60)),
+			MakeTimeAccessor(&EmailNewsletterApplication::m_retryDelay),
+			MakeTimeChecker())
 		.AddAttribute("Protocol", "The type of protocol to use.",
 			TypeIdValue(TcpSocketFactory::GetTypeId()),
 			MakeTypeIdAccessor(&EmailNewsletterApplication::m_tid),
 			MakeTypeIdChecker())
 		.AddTraceSource("Tx", "A new packet is created and is sent",
 			MakeTraceSourceAccessor(&EmailNewsletterApplication::m_txTrace),
-			"ns3::Packet::TracedCallback");
+			"ns3::Packet::TracedCallback")
+		.AddTraceSource("Delivered", "The server has accepted a mail",
+			MakeTraceSourceAccessor(&EmailNewsletterApplication::m_deliveredTrace),
+			"ns3::EmailNewsletterApplication::DeliveredTracedCallback")
+		.AddTraceSource("Completed", "The last recipient has been delivered or rejected",
+			MakeTraceSourceAccessor(&EmailNewsletterApplication::m_completedTrace),
+			"ns3::EmailNewsletterApplication::CompletedTracedCallback");
 
 	return tid;
 }
 
 
 EmailNewsletterApplication::EmailNewsletterApplication()
-	: m_socket(0)
-	, m_connected(false)
-	, m_rtt(50)
+	: m_peerRecipients(0)
+	, m_running(false)
 	, m_receiverPerServer(100)
-	, m_sentMails(0)
-	, m_remaining(0) {
+	, m_recipientsPerMail(1)
+	, m_pipelining(true)
+	, m_maxConnectionsPerDestination(1)
+	, m_maxConnections(0)
+	, m_openConnections(0)
+	, m_unfinishedRecipients(0)
+	, m_unlimitedDestinations(0)
+	, m_totalMails(0)
+	, m_totalRecipients(0)
+	, m_rejectedRecipients(0)
+	, m_deferredRecipients(0)
+	, m_totalConnections(0)
+	, m_reusedTransactions(0)
+	, m_maxOpenConnections(0) {
 	NS_LOG_FUNCTION(this);
 }
 
@@ -83,154 +558,303 @@ EmailNewsletterApplication::~EmailNewsletterApplication() {
 	NS_LOG_FUNCTION(this);
 }
 
-void EmailNewsletterApplication::SetRtt(uint64_t rtt) {
+void EmailNewsletterApplication::SetReceiverPerServer(uint32_t rps) {
 	NS_LOG_FUNCTION(this);
-	m_rtt = rtt;
+	m_receiverPerServer = rps;
 }
 
-void EmailNewsletterApplication::SetReceiverPerServer(uint32_t rps) {
+uint32_t EmailNewsletterApplication::AddDestination(const Address& address, uint64_t recipients) {
+	NS_LOG_FUNCTION(this << address << recipients);
+
+	Destination d;
+	d.m_address = address;
+	d.m_remaining = recipients;
+	d.m_unlimited = recipients == 0;
+	m_destinations.push_back(d);
+
+	if (d.m_unlimited) {
+		m_unlimitedDestinations++;
+	}
+	else {
+		m_unfinishedRecipients += recipients;
+	}
+
+	return m_destinations.size() - 1;
+}
+
+uint64_t EmailNewsletterApplication::GetTotalMails(void) const {
 	NS_LOG_FUNCTION(this);
-	m_receiverPerServer = rps;
+	return m_totalMails;
 }
 
-Ptr<Socket> EmailNewsletterApplication::GetSocket(void) const {
+uint64_t EmailNewsletterApplication::GetTotalRecipients(void) const {
 	NS_LOG_FUNCTION(this);
-	return m_socket;
+	return m_totalRecipients;
+}
+
+uint64_t EmailNewsletterApplication::GetRejectedRecipients(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_rejectedRecipients;
+}
+
+uint64_t EmailNewsletterApplication::GetDeferredRecipients(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_deferredRecipients;
+}
+
+uint64_t EmailNewsletterApplication::GetTotalConnections(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_totalConnections;
+}
+
+uint64_t EmailNewsletterApplication::GetReusedTransactions(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_reusedTransactions;
+}
+
+uint32_t EmailNewsletterApplication::GetMaxOpenConnections(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_maxOpenConnections;
+}
+
+Time EmailNewsletterApplication::GetTotalDeliveryTime(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_totalDeliveryTime;
+}
+
+Time EmailNewsletterApplication::GetCompletionTime(void) const {
+	NS_LOG_FUNCTION(this);
+	return m_completionTime;
 }
 
 void EmailNewsletterApplication::DoDispose(void) {
 	NS_LOG_FUNCTION(this);
 
-	m_socket = 0;
+	m_destinations.clear();
+	m_waiting.clear();
+	m_payload = 0;
 	Application::DoDispose();
 }
 
 void EmailNewsletterApplication::StartApplication(void) {
 	NS_LOG_FUNCTION(this);
 
-	if (!m_socket) {
-		m_socket = Socket::CreateSocket(GetNode(), m_tid);
-
-		if (m_socket->GetSocketType() != Socket::NS3_SOCK_STREAM && m_socket->GetSocketType() != Socket::NS3_SOCK_SEQPACKET) {
-			NS_FATAL_ERROR("Using EmailNewsletter with an incompatible socket type. "
-				"EmailNewsletter requires SOCK_STREAM or SOCK_SEQPACKET. "
-				"In other words, use TCP instead of UDP.");
-		}
-
-		if (Inet6SocketAddress::IsMatchingType(m_peer)) {
-			m_socket->Bind6();
-		}
-		else if (InetSocketAddress::IsMatchingType(m_peer)) {
-			m_socket->Bind();
-		}
+	// zero-filled and never written, so every mail is a fragment of this one packet
+	if (!m_payload || m_payload->GetSize() != m_sendSize) {
+		m_payload = Create<Packet>(m_sendSize);
+	}
 
-		m_socket->Connect(m_peer);
-		m_socket->ShutdownRecv();
-		m_socket->SetConnectCallback(
-			MakeCallback(&EmailNewsletterApplication::ConnectionSucceeded, this),
-			MakeCallback(&EmailNewsletterApplication::ConnectionFailed, this)
-		);
-		m_socket->SetSendCallback(MakeCallback(&EmailNewsletterApplication::BufferAvailableCb, this));
+	if (!m_peer.IsInvalid() && m_destinations.empty()) {
+		AddDestination(m_peer, m_peerRecipients);
 	}
 
-	if (m_connected) {
-		Time tcpOverheadTime(MilliSeconds(m_rtt));
-		m_sendEvent = Simulator::Schedule(tcpOverheadTime, &EmailNewsletterApplication::ScheduleNextMail, this);
+	m_running = true;
+
+	for (uint32_t i = 0; i < m_destinations.size(); i++) {
+		Dispatch(i);
 	}
 }
 
 void EmailNewsletterApplication::StopApplication(void) {
 	NS_LOG_FUNCTION(this);
 
-	if (m_socket != 0) {
-		m_socket->Close();
-		m_connected = false;
+	m_running = false;
+
+	for (std::vector<Destination>::iterator d = m_destinations.begin(); d != m_destinations.end(); ++d) {
+		Simulator::Cancel(d->m_dispatchEvent);
+
+		for (std::vector<Ptr<EmailNewsletterSession> >::iterator it = d->m_sessions.begin(); it != d->m_sessions.end(); ++it) {
+			(*it)->Close();
+		}
+
+		d->m_sessions.clear();
+		d->m_waiting = false;
 	}
-	else {
-		NS_LOG_WARN("EmailNewsletterApplication found null socket to close in StopApplication");
+
+	m_waiting.clear();
+	m_openConnections = 0;
+}
+
+bool EmailNewsletterApplication::HasWork(const Destination& d) const {
+	return d.m_unlimited || d.m_remaining > 0 || (!d.m_retries.empty() && d.m_retries.front().first <= Simulator::Now());
+}
+
+uint64_t EmailNewsletterApplication::GetWork(const Destination& d) const {
+	if (d.m_unlimited) {
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+	uint64_t work = d.m_remaining;
+
+	for (std::deque<std::pair<Time, uint64_t> >::const_iterator it = d.m_retries.begin(); it != d.m_retries.end() && it->first <= Simulator::Now(); ++it) {
+		work++;
 	}
+
+	return work;
 }
 
+bool EmailNewsletterApplication::IsFinished(const Destination& d) const {
+	return !d.m_unlimited && d.m_remaining == 0 && d.m_retries.empty();
+}
 
-void EmailNewsletterApplication::SendMail(void) {
-	NS_LOG_FUNCTION(this);
+void EmailNewsletterApplication::Dispatch(uint32_t destination) {
+	NS_LOG_FUNCTION(this << destination);
 
-	uint64_t toSend = m_sendSize;
+	if (!m_running) {
+		return;
+	}
 
-	NS_LOG_LOGIC("sending packet at " << Simulator::Now());
-	Ptr<Packet> packet = Create<Packet>(toSend);
-	m_txTrace(packet);
-	int actual = m_socket->Send(packet);
+	Destination& d = m_destinations[destination];
 
-	if ((unsigned) actual != toSend) {
-		m_remaining = toSend - actual;
+	// idle connections come first, they have paid their handshakes already
+	for (uint32_t i = 0; i < d.m_sessions.size() && HasWork(d); i++) {
+		if (d.m_sessions[i]->IsIdle()) {
+			d.m_sessions[i]->Wake();
+		}
+	}
+
+	Time next;
+
+	if (Simulator::Now() < d.m_backoff) {
+		next = d.m_backoff;
 	}
 	else {
-		m_remaining = 0;
-		m_sentMails++;
+		uint64_t connecting = 0;
+
+		for (uint32_t i = 0; i < d.m_sessions.size(); i++) {
+			connecting += d.m_sessions[i]->IsConnecting();
+		}
+
+		// a new connection takes one transaction as soon as it is ready
+		uint64_t work = GetWork(d);
+
+		while (d.m_sessions.size() < m_maxConnectionsPerDestination && work > connecting * m_recipientsPerMail) {
+			if (m_maxConnections > 0 && m_openConnections >= m_maxConnections) {
+				// SessionClosed() comes back in the order the destinations queued up
+				if (!d.m_waiting) {
+					d.m_waiting = true;
+					m_waiting.push_back(destination);
+				}
+
+				break;
+			}
+
+			Ptr<EmailNewsletterSession> session = Create<EmailNewsletterSession>(this, destination);
+			d.m_sessions.push_back(session);
+			m_openConnections++;
+			m_maxOpenConnections = std::max(m_maxOpenConnections, m_openConnections);
+			connecting++;
+			session->Connect();
+		}
+	}
 
-		ScheduleNextMail();
+	// come back for the next deferred recipient
+	if (!d.m_retries.empty() && d.m_retries.front().first > Simulator::Now() && (next.IsZero() || d.m_retries.front().first < next)) {
+		next = d.m_retries.front().first;
 	}
 
-	CheckMailCount();
+	Simulator::Cancel(d.m_dispatchEvent);
+
+	if (!next.IsZero()) {
+		d.m_dispatchEvent = Simulator::Schedule(next - Simulator::Now(), &EmailNewsletterApplication::Dispatch, this, destination);
+	}
 }
 
-void EmailNewsletterApplication::SendRemaining(void) {
-	NS_LOG_FUNCTION(this);
-	NS_LOG_LOGIC("sending packet at " << Simulator::Now());
+void EmailNewsletterApplication::TakeRecipients(uint32_t destination, uint32_t count, std::deque<uint64_t>& recipients) {
+	Destination& d = m_destinations[destination];
 
-	uint64_t toSend = m_remaining;
-	Ptr<Packet> packet = Create<Packet>(toSend);
-	m_txTrace(packet);
-	int actual = m_socket->Send(packet);
+	// deferred recipients that are due come before new ones
+	while (recipients.size() < count) {
+		if (!d.m_retries.empty() && d.m_retries.front().first <= Simulator::Now()) {
+			recipients.push_back(d.m_retries.front().second);
+			d.m_retries.pop_front();
+		}
+		else if (d.m_unlimited || d.m_remaining > 0) {
+			recipients.push_back(d.m_nextRecipient++);
 
-	if ((unsigned) actual != toSend) {
-		m_remaining = toSend - actual;
+			if (!d.m_unlimited) {
+				d.m_remaining--;
+			}
+		}
+		else {
+			break;
+		}
 	}
-	else {
-		m_remaining = 0;
-		m_sentMails++;
 
-		ScheduleNextMail();
-	}
+	d.m_inFlight += recipients.size();
+}
+
+void EmailNewsletterApplication::Delivered(uint32_t destination, uint32_t recipients, Time delay) {
+	m_destinations[destination].m_inFlight -= recipients;
+	m_totalMails++;
+	m_totalRecipients += recipients;
+	m_totalDeliveryTime += delay;
+	m_deliveredTrace(recipients, delay);
 
-	CheckMailCount();
+	CheckCompletion(destination, recipients);
 }
 
-void EmailNewsletterApplication::ScheduleNextMail(void) {
-	NS_LOG_FUNCTION(this);
+void EmailNewsletterApplication::Rejected(uint32_t destination, uint32_t recipients) {
+	m_destinations[destination].m_inFlight -= recipients;
+	m_rejectedRecipients += recipients;
 
-	Time smtpOverheadTime(MilliSeconds(m_rtt * 4));
-	m_sendEvent = Simulator::Schedule(smtpOverheadTime, &EmailNewsletterApplication::SendMail, this);
+	CheckCompletion(destination, recipients);
 }
 
-void EmailNewsletterApplication::CheckMailCount(void) {
-	if (m_sentMails >= m_receiverPerServer) {
-		m_sentMails = 0;
-		Simulator::Cancel(m_sendEvent);
+void EmailNewsletterApplication::Defer(uint32_t destination, uint64_t recipient) {
+	NS_LOG_FUNCTION(this << destination << recipient);
+
+	Destination& d = m_destinations[destination];
+	d.m_inFlight--;
+	d.m_retries.push_back(std::make_pair(Simulator::Now() + m_retryDelay, recipient));
+	m_deferredRecipients++;
 
-		Time tcpOverheadTime(MilliSeconds(m_rtt * 2));
-		m_sendEvent = Simulator::Schedule(tcpOverheadTime, &EmailNewsletterApplication::ScheduleNextMail, this);
+	if (m_running && !d.m_dispatchEvent.IsRunning()) {
+		d.m_dispatchEvent = Simulator::Schedule(m_retryDelay, &EmailNewsletterApplication::Dispatch, this, destination);
 	}
 }
 
-void EmailNewsletterApplication::ConnectionSucceeded(Ptr<Socket> socket) {
-	NS_LOG_FUNCTION(this << socket);
-	NS_LOG_LOGIC("EmailNewsletterApplication Connection succeeded");
+void EmailNewsletterApplication::Backoff(uint32_t destination) {
+	NS_LOG_FUNCTION(this << destination);
 
-	m_connected = true;
+	m_destinations[destination].m_backoff = Simulator::Now() + m_retryDelay;
 }
 
-void EmailNewsletterApplication::ConnectionFailed(Ptr<Socket> socket) {
-	NS_LOG_FUNCTION(this << socket);
-	NS_LOG_LOGIC("EmailNewsletterApplication, Connection Failed");
+void EmailNewsletterApplication::SessionClosed(Ptr<EmailNewsletterSession> session) {
+	NS_LOG_FUNCTION(this);
+
+	Destination& d = m_destinations[session->GetDestination()];
+	std::vector<Ptr<EmailNewsletterSession> >::iterator it = std::find(d.m_sessions.begin(), d.m_sessions.end(), session);
+
+	if (it == d.m_sessions.end()) {
+		return;
+	}
+
+	d.m_sessions.erase(it);
+	m_openConnections--;
+
+	// destinations waiting for a connection go before a replacement of this one
+	while (!m_waiting.empty() && (m_maxConnections == 0 || m_openConnections < m_maxConnections)) {
+		uint32_t waiting = m_waiting.front();
+		m_waiting.pop_front();
+		m_destinations[waiting].m_waiting = false;
+		Dispatch(waiting);
+	}
+
+	// replace the connection if recipients are left
+	Dispatch(session->GetDestination());
 }
 
-void EmailNewsletterApplication::BufferAvailableCb(Ptr<Socket>, uint32_t) {
-	NS_LOG_FUNCTION(this);
+void EmailNewsletterApplication::CheckCompletion(uint32_t destination, uint32_t recipients) {
+	if (m_destinations[destination].m_unlimited) {
+		return;
+	}
+
+	m_unfinishedRecipients -= recipients;
 
-	if (m_connected && m_remaining != 0) {
-		SendRemaining();
+	if (m_unfinishedRecipients == 0 && m_unlimitedDestinations == 0) {
+		m_completionTime = Simulator::Now();
+		m_completedTrace();
 	}
 }
 
@@ -24,14 +24,123 @@
 #include "ns3/address.h"
 #include "ns3/application.h"
 #include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
 #include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
 #include "ns3/traced-callback.h"
 
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace ns3 {
 
 class Address;
 class Socket;
+class EmailNewsletterApplication;
+
+/**
+ * One SMTP connection of EmailNewsletterApplication. After the greeting and
+ * EHLO it asks the application for recipients of its destination, delivers
+ * them in transactions of up to RecipientsPerMail RCPT commands and stays
+ * open for the next ones. It leaves with QUIT after ReceiverPerServer
+ * recipients or IdleTimeout without work.
+ *
+ * With Pipelining, and if the server offers PIPELINING in its EHLO reply,
+ * MAIL, all RCPT and DATA of a transaction go out in one batch (RFC 2920),
+ * otherwise every command waits for the reply to the previous one. The mail
+ * body is SendSize virtual bytes announced with the SIZE parameter of MAIL
+ * FROM (RFC 1870), so the server does not have to scan it for the end of
+ * data.
+ */
+class EmailNewsletterSession : public SimpleRefCount<EmailNewsletterSession> {
+public:
+	EmailNewsletterSession(EmailNewsletterApplication* app, uint32_t destination);
+
+	void Connect(void);
+	void Close(void);
+
+	/**
+	 * Starts the next transaction if the session waits for work.
+	 */
+	void Wake(void);
+
+	bool IsIdle(void) const;
+	bool IsConnecting(void) const;
+	uint32_t GetDestination(void) const;
+
+private:
+	/**
+	 * Command whose reply is expected next.
+	 */
+	enum SmtpCommand {
+		SMTP_GREETING,
+		SMTP_EHLO,
+		SMTP_MAIL,
+		SMTP_RCPT,
+		SMTP_DATA,
+		SMTP_DATA_END,
+		SMTP_RSET,
+		SMTP_QUIT
+	};
+
+	void ConnectionSucceeded(Ptr<Socket> socket);
+	void ConnectionFailed(Ptr<Socket> socket);
+	void HandleRead(Ptr<Socket> socket);
+	void HandlePeerClose(Ptr<Socket> socket);
+	void HandleReply(uint32_t code, const std::string& text);
+	void SendCommand(SmtpCommand command, const std::string& line);
+	void SendEnvelope(void);
+	void SendMail(void);
+	void SendRemaining(void);
+	void BufferAvailableCb(Ptr<Socket>, uint32_t);
+	void IdleTimeout(void);
+	void Abort(void);
+
+	EmailNewsletterApplication* m_app;
+	uint32_t	m_destination;	//!< Index into the application's destinations
+	Ptr<Socket>	m_socket;
+	bool		m_connected;
+	bool		m_ready;	//!< EHLO accepted
+	bool		m_idle;		//!< Ready, but without a transaction
+	bool		m_serverPipelining;	//!< The server offered PIPELINING
+
+	std::string	m_rxBuffer;	//!< Received reply bytes not yet ending with CRLF
+	std::string	m_txBuffer;	//!< Command bytes the socket has not taken yet
+	std::deque<SmtpCommand> m_awaiting;	//!< Sent commands whose replies are outstanding
+	std::deque<std::pair<SmtpCommand, std::string> > m_envelope;	//!< Commands of the transaction not sent yet
+	bool		m_sendingData;	//!< 354 received, body not completely sent yet
+	uint32_t	m_offset;	//!< Bytes of the current mail body already sent
+
+	uint32_t	m_sentRecipients;	//!< RCPT commands sent on this connection
+	uint32_t	m_mails;	//!< Transactions started on this connection
+	std::deque<uint64_t> m_mailRcpts;	//!< Recipients of the transaction without a reply to their RCPT yet
+	std::vector<uint64_t> m_acceptedRcpts;	//!< Recipients of the transaction accepted by RCPT
+	Time		m_mailStart;
+	EventId		m_idleEvent;
+};
 
+/**
+ * Sends a newsletter over SMTP to one or more destination servers, Remote
+ * and those added with AddDestination(). The application keeps a pool of
+ * connections per destination: up to MaxConnectionsPerDestination are
+ * opened while recipients are waiting, a connection that finished a
+ * transaction takes the next recipients of its destination, idle ones are
+ * closed after IdleTimeout and replaced when new work arrives. The TCP and
+ * SMTP handshakes are therefore paid per real connection.
+ *
+ * MaxConnections caps the connections to all destinations together. A
+ * destination that needs a connection while the cap is reached waits in
+ * line for the next one that closes, and connections quit as soon as their
+ * destination has no recipients left instead of idling.
+ *
+ * Recipients refused with a 4xx reply, e.g. by greylisting, are retried in a
+ * later transaction after RetryDelay, 5xx replies are final. A 421 reply or
+ * a failed connection keeps the destination from getting new connections
+ * for RetryDelay.
+ */
 class EmailNewsletterApplication : public Application {
 public:
 	static TypeId GetTypeId(void);
@@ -39,39 +148,127 @@ public:
 	EmailNewsletterApplication();
 	virtual ~EmailNewsletterApplication();
 
-	void SetRtt(uint64_t rtt);
 	void SetReceiverPerServer(uint32_t rps);
 
-	Ptr<Socket> GetSocket(void) const;
+	/**
+	 * Adds a destination server with the given number of recipients, 0 for an
+	 * endless newsletter. Call before the application starts.
+	 */
+	uint32_t AddDestination(const Address& address, uint64_t recipients);
+
+	uint64_t GetTotalMails(void) const;
+	uint64_t GetTotalRecipients(void) const;
+	uint64_t GetRejectedRecipients(void) const;
+	uint64_t GetDeferredRecipients(void) const;
+	uint64_t GetTotalConnections(void) const;
+	uint64_t GetReusedTransactions(void) const;
+	uint32_t GetMaxOpenConnections(void) const;
+	Time GetTotalDeliveryTime(void) const;
+
+	/**
+	 * Time the last recipient was delivered or rejected, zero while recipients are left or for an endless newsletter.
+	 */
+	Time GetCompletionTime(void) const;
+
+	/**
+	 * Recipients accepted for one delivered mail and the time from MAIL FROM to the final 250.
+	 */
+	typedef void (* DeliveredTracedCallback)(uint32_t recipients, Time delay);
+
+	/**
+	 * The last recipient has been delivered or rejected.
+	 */
+	typedef void (* CompletedTracedCallback)(void);
 
 protected:
 	virtual void DoDispose(void);
 
 private:
+	friend class EmailNewsletterSession;
+
+	/**
+	 * A destination server and its recipients and connections.
+	 */
+	struct Destination {
+		Destination()
+			: m_remaining(0)
+			, m_unlimited(false)
+			, m_nextRecipient(0)
+			, m_inFlight(0)
+			, m_waiting(false) {}
+
+		Address		m_address;
+		uint64_t	m_remaining;	//!< Recipients not tried yet
+		bool		m_unlimited;
+		uint64_t	m_nextRecipient;
+		uint64_t	m_inFlight;	//!< Recipients in open transactions
+		std::deque<std::pair<Time, uint64_t> > m_retries;	//!< Deferred recipients in the order they are due
+		std::vector<Ptr<EmailNewsletterSession> > m_sessions;
+		Time		m_backoff;	//!< No new connection before
+		EventId		m_dispatchEvent;
+		bool		m_waiting;	//!< In m_waiting for a connection
+	};
+
 	virtual void StartApplication(void);
 	virtual void StopApplication(void);
 
-	void ConnectionSucceeded(Ptr<Socket> socket);
-	void ConnectionFailed(Ptr<Socket> socket);
-	void SendMail(void);
-	void SendRemaining(void);
-	void ScheduleNextMail(void);
-	void CheckMailCount(void);
-	void BufferAvailableCb(Ptr<Socket>, uint32_t);
+	/**
+	 * Wakes idle connections of the destination and opens new ones while recipients are waiting.
+	 */
+	void Dispatch(uint32_t destination);
+	bool HasWork(const Destination& d) const;
+	uint64_t GetWork(const Destination& d) const;
+
+	/**
+	 * No recipients left to try now or later, only those in open transactions.
+	 */
+	bool IsFinished(const Destination& d) const;
+
+	/**
+	 * Moves up to count recipients of the destination into the caller's transaction.
+	 */
+	void TakeRecipients(uint32_t destination, uint32_t count, std::deque<uint64_t>& recipients);
+	void Delivered(uint32_t destination, uint32_t recipients, Time delay);
+	void Rejected(uint32_t destination, uint32_t recipients);
+	void Defer(uint32_t destination, uint64_t recipient);
+	void Backoff(uint32_t destination);
+	void SessionClosed(Ptr<EmailNewsletterSession> session);
+	void CheckCompletion(uint32_t destination, uint32_t recipients);
 
-	Ptr<Socket>	m_socket;	//!< Associated socket
 	Address		m_peer;		//!< Peer address
-	bool		m_connected;	//!< True if connected
+	uint64_t	m_peerRecipients;	//!< Recipients of m_peer, 0 for no limit
 	uint32_t	m_sendSize;	//!< Size of data to send each time
 	TypeId		m_tid;		//!< The type of protocol to use.
+	bool		m_running;	//!< Between StartApplication and StopApplication
 
-	EventId		m_sendEvent;
-	uint64_t	m_rtt;
 	uint32_t	m_receiverPerServer;
-	uint32_t	m_sentMails;
-	uint64_t	m_remaining;
+	uint32_t	m_recipientsPerMail;
+	bool		m_pipelining;	//!< Pipeline commands if the server supports it
+	uint32_t	m_maxConnectionsPerDestination;
+	uint32_t	m_maxConnections;	//!< 0 for no limit
+	Time		m_idleTimeout;
+	Time		m_retryDelay;
+
+	std::vector<Destination> m_destinations;
+	Ptr<Packet>	m_payload;	//!< Mail body all sent packets are fragments of
+	uint32_t	m_openConnections;
+	std::deque<uint32_t> m_waiting;	//!< Destinations waiting for a connection below MaxConnections
+	uint64_t	m_unfinishedRecipients;	//!< Recipients of limited destinations neither delivered nor rejected
+	uint32_t	m_unlimitedDestinations;
+
+	uint64_t	m_totalMails;	//!< Mails accepted by the server
+	uint64_t	m_totalRecipients;
+	uint64_t	m_rejectedRecipients;
+	uint64_t	m_deferredRecipients;
+	uint64_t	m_totalConnections;
+	uint64_t	m_reusedTransactions;	//!< Transactions on a connection that had one before
+	uint32_t	m_maxOpenConnections;
+	Time		m_totalDeliveryTime;
+	Time		m_completionTime;
 
 	TracedCallback<Ptr<const Packet>> m_txTrace;
+	TracedCallback<uint32_t, Time> m_deliveredTrace;
+	TracedCallback<> m_completedTrace;
 };
 
 } // namespace ns3
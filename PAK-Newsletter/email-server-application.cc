@@ -0,0 +1,439 @@
+#include "ns3/log.h"
+#include "ns3/address.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/node.h"
+#include "ns3/socket.h"
+#include "ns3/simulator.h"
+#include "ns3/socket-factory.h"
+#include "ns3/packet.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-source-accessor.h"
+#include "ns3/tcp-socket-factory.h"
+#include "email-server-application.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("EmailServerApplication");
+NS_OBJECT_ENSURE_REGISTERED(EmailServerApplication);
+
+TypeId EmailServerApplication::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::EmailServerApplication")
+		.SetParent<Application>()
+		.SetGroupName("Applications")
+		.AddConstructor<EmailServerApplication>()
+		.AddAttribute("Local", "The address on which to accept SMTP connections",
+			AddressValue(),
+			MakeAddressAccessor(&EmailServerApplication::m_local),
+			MakeAddressChecker())
+		.AddAttribute("Protocol", "The type of protocol to use.",
+			TypeIdValue(TcpSocketFactory::GetTypeId()),
+			MakeTypeIdAccessor(&EmailServerApplication::m_tid),
+			MakeTypeIdChecker())
+		.AddAttribute("Pipelining", "Offer PIPELINING in the EHLO reply.",
+			BooleanValue(true),
+			MakeBooleanAccessor(&EmailServerApplication::m_pipelining),
+			MakeBooleanChecker())
+		.AddAttribute("MaxConnections", "Maximum number of open SMTP sessions, 0 for no limit.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&EmailServerApplication::m_maxConnections),
+			MakeUintegerChecker<uint32_t>())
+		.AddAttribute("MaxConnectionsPerPeer", "Maximum number of open SMTP sessions of one client address, 0 for no limit.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&EmailServerApplication::m_maxConnectionsPerPeer),
+			MakeUintegerChecker<uint32_t>())
+		.AddAttribute("MaxRecipientsPerMail", "Maximum number of accepted RCPT commands per transaction, 0 for no limit.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&EmailServerApplication::m_maxRecipientsPerMail),
+			MakeUintegerChecker<uint32_t>())
+		.AddAttribute("GreylistProbability", "Probability that a new recipient is greylisted.",
+			DoubleValue(0),
+			MakeDoubleAccessor(&EmailServerApplication::m_greylistProbability),
+			MakeDoubleChecker<double>(0, 1))
+		.AddAttribute("GreylistDelay", "Time before a greylisted recipient is accepted.",
+			TimeValue(Seconds(300)),
+			MakeTimeAccessor(&EmailServerApplication::m_greylistDelay),
+			MakeTimeChecker())
+		.AddAttribute("CommandTime", "Processing time in seconds before a batch of replies is sent.",
+			StringValue("ns3::ConstantRandomVariable[Constant=0]"),
+			MakePointerAccessor(&EmailServerApplication::m_commandTime),
+			MakePointerChecker<RandomVariableStream>())
+		.AddAttribute("AcceptTime", "Additional processing time in seconds before a mail body is accepted.",
+			StringValue("ns3::ConstantRandomVariable[Constant=0]"),
+			MakePointerAccessor(&EmailServerApplication::m_acceptTime),
+			MakePointerChecker<RandomVariableStream>())
+		.AddTraceSource("Rx", "A packet has been received",
+			MakeTraceSourceAccessor(&EmailServerApplication::m_rxTrace),
+			"ns3::Packet::AddressTracedCallback");
+
+	return tid;
+}
+
+
+EmailServerApplication::EmailServerApplication()
+	: m_socket(0)
+	, m_pipelining(true)
+	, m_maxConnections(0)
+	, m_maxConnectionsPerPeer(0)
+	, m_maxRecipientsPerMail(0)
+	, m_greylistProbability(0)
+	, m_totalRx(0)
+	, m_totalMails(0)
+	, m_totalRecipients(0)
+	, m_greylisted(0)
+	, m_refusedConnections(0)
+	, m_maxSessions(0) {
+	NS_LOG_FUNCTION(this);
+
+	m_random = CreateObject<UniformRandomVariable>();
+}
+
+EmailServerApplication::~EmailServerApplication() {
+	NS_LOG_FUNCTION(this);
+}
+
+uint64_t EmailServerApplication::GetTotalRx(void) const {
+	return m_totalRx;
+}
+
+uint64_t EmailServerApplication::GetTotalMails(void) const {
+	return m_totalMails;
+}
+
+uint64_t EmailServerApplication::GetTotalRecipients(void) const {
+	return m_totalRecipients;
+}
+
+uint64_t EmailServerApplication::GetUniqueRecipients(void) const {
+	return m_deliveries.size();
+}
+
+uint64_t EmailServerApplication::GetDuplicateRecipients(void) const {
+	return m_totalRecipients - m_deliveries.size();
+}
+
+uint64_t EmailServerApplication::GetGreylistedRecipients(void) const {
+	return m_greylisted;
+}
+
+uint64_t EmailServerApplication::GetRefusedConnections(void) const {
+	return m_refusedConnections;
+}
+
+uint32_t EmailServerApplication::GetMaxSessions(void) const {
+	return m_maxSessions;
+}
+
+void EmailServerApplication::DoDispose(void) {
+	NS_LOG_FUNCTION(this);
+
+	m_socket = 0;
+	m_sessions.clear();
+	m_commandTime = 0;
+	m_acceptTime = 0;
+	m_random = 0;
+	Application::DoDispose();
+}
+
+void EmailServerApplication::StartApplication(void) {
+	NS_LOG_FUNCTION(this);
+
+	if (!m_socket) {
+		m_socket = Socket::CreateSocket(GetNode(), m_tid);
+		m_socket->Bind(m_local);
+		m_socket->Listen();
+	}
+
+	m_socket->SetAcceptCallback(
+		MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+		MakeCallback(&EmailServerApplication::HandleAccept, this)
+	);
+}
+
+void EmailServerApplication::StopApplication(void) {
+	NS_LOG_FUNCTION(this);
+
+	for (std::map<Ptr<Socket>, Session>::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+		it->first->Close();
+	}
+
+	m_sessions.clear();
+	m_peerSessions.clear();
+
+	if (m_socket) {
+		m_socket->Close();
+		m_socket->SetAcceptCallback(
+			MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+			MakeNullCallback<void, Ptr<Socket>, const Address&>()
+		);
+	}
+}
+
+void EmailServerApplication::HandleAccept(Ptr<Socket> socket, const Address& from) {
+	NS_LOG_FUNCTION(this << socket << from);
+
+	socket->SetRecvCallback(MakeCallback(&EmailServerApplication::HandleRead, this));
+	socket->SetCloseCallbacks(
+		MakeCallback(&EmailServerApplication::HandlePeerClose, this),
+		MakeCallback(&EmailServerApplication::HandlePeerError, this)
+	);
+
+	uint32_t peer = InetSocketAddress::IsMatchingType(from) ? InetSocketAddress::ConvertFrom(from).GetIpv4().Get() : 0;
+
+	// a busy server still answers, but only to say that it is busy
+	if ((m_maxConnections > 0 && m_sessions.size() >= m_maxConnections)
+		|| (m_maxConnectionsPerPeer > 0 && m_peerSessions[peer] >= m_maxConnectionsPerPeer)) {
+		m_refusedConnections++;
+		SendReply(socket, "421 4.7.0 mx.example.net Too many connections, try again later\r\n", true);
+		return;
+	}
+
+	Session& session = m_sessions[socket];
+	session.m_peer = peer;
+	session.m_reply = "220 mx.example.net ESMTP\r\n";
+	m_peerSessions[peer]++;
+	m_maxSessions = std::max<uint32_t>(m_maxSessions, m_sessions.size());
+
+	ScheduleReply(socket, session);
+}
+
+void EmailServerApplication::HandleRead(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+
+	std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find(socket);
+
+	if (it == m_sessions.end()) {
+		return;
+	}
+
+	Session& session = it->second;
+	Ptr<Packet> packet;
+	Address from;
+
+	while ((packet = socket->RecvFrom(from))) {
+		uint32_t size = packet->GetSize();
+
+		if (size == 0) {
+			break;
+		}
+
+		m_totalRx += size;
+		m_rxTrace(packet, from);
+
+		// the announced body is only counted, never copied
+		uint32_t skip = std::min<uint64_t>(session.m_dataRemaining, size);
+		session.m_dataRemaining -= skip;
+
+		if (skip < size) {
+			std::vector<uint8_t> data(size - skip);
+			packet->CreateFragment(skip, size - skip)->CopyData(&data[0], data.size());
+			session.m_line.append(data.begin(), data.end());
+			HandleLines(session);
+		}
+	}
+
+	ScheduleReply(socket, session);
+}
+
+void EmailServerApplication::HandleLines(Session& session) {
+	NS_LOG_FUNCTION(this);
+
+	while (!session.m_line.empty()) {
+		if (session.m_dataRemaining > 0) {
+			uint32_t skip = std::min<uint64_t>(session.m_dataRemaining, session.m_line.size());
+			session.m_dataRemaining -= skip;
+			session.m_line.erase(0, skip);
+			continue;
+		}
+
+		std::string::size_type end = session.m_line.find("\r\n");
+
+		if (end == std::string::npos) {
+			return;
+		}
+
+		std::string line = session.m_line.substr(0, end);
+		session.m_line.erase(0, end + 2);
+		HandleLine(session, line);
+	}
+}
+
+void EmailServerApplication::HandleLine(Session& session, const std::string& line) {
+	NS_LOG_FUNCTION(this << line);
+
+	if (session.m_data) {
+		// the body without SIZE and the CRLF before the terminator are ignored
+		if (line == ".") {
+			m_totalMails++;
+			m_totalRecipients += session.m_rcpts.size();
+
+			for (std::vector<std::string>::const_iterator it = session.m_rcpts.begin(); it != session.m_rcpts.end(); ++it) {
+				m_deliveries[*it]++;
+			}
+
+			session.m_delay += Seconds(m_acceptTime->GetValue());
+			session.m_reply += "250 2.0.0 OK queued\r\n";
+			ResetTransaction(session);
+		}
+
+		return;
+	}
+
+	std::string verb = line.substr(0, 4);
+	std::transform(verb.begin(), verb.end(), verb.begin(), ::toupper);
+
+	if (verb == "EHLO") {
+		session.m_reply += "250-mx.example.net\r\n";
+
+		if (m_pipelining) {
+			session.m_reply += "250-PIPELINING\r\n";
+		}
+
+		session.m_reply += "250 SIZE\r\n";
+	}
+	else if (verb == "HELO") {
+		session.m_reply += "250 mx.example.net\r\n";
+	}
+	else if (verb == "MAIL") {
+		if (session.m_mail) {
+			session.m_reply += "503 5.5.1 Nested MAIL command\r\n";
+			return;
+		}
+
+		std::string::size_type size = line.find("SIZE=");
+
+		session.m_mail = true;
+		session.m_size = size != std::string::npos ? std::strtoull(line.c_str() + size + 5, 0, 10) : 0;
+		session.m_rcpts.clear();
+		session.m_reply += "250 2.1.0 OK\r\n";
+	}
+	else if (verb == "RCPT") {
+		if (!session.m_mail) {
+			session.m_reply += "503 5.5.1 Need MAIL command\r\n";
+			return;
+		}
+
+		if (m_maxRecipientsPerMail > 0 && session.m_rcpts.size() >= m_maxRecipientsPerMail) {
+			session.m_reply += "452 4.5.3 Too many recipients\r\n";
+			return;
+		}
+
+		std::string::size_type begin = line.find('<');
+		std::string::size_type end = line.find('>', begin);
+		std::string recipient = begin != std::string::npos && end != std::string::npos ? line.substr(begin + 1, end - begin - 1) : line.substr(std::min<std::string::size_type>(line.size(), 8));
+
+		// the first attempt of a greylisted recipient fails, a retry after GreylistDelay passes
+		if (m_greylistProbability > 0 && m_deliveries.find(recipient) == m_deliveries.end()) {
+			std::map<std::string, Time>::iterator it = m_greylist.find(recipient);
+
+			if (it == m_greylist.end() && m_random->GetValue() < m_greylistProbability) {
+				m_greylist[recipient] = Simulator::Now();
+				m_greylisted++;
+				session.m_reply += "451 4.7.1 Greylisted, try again later\r\n";
+				return;
+			}
+
+			if (it != m_greylist.end() && Simulator::Now() - it->second < m_greylistDelay) {
+				session.m_reply += "451 4.7.1 Greylisted, try again later\r\n";
+				return;
+			}
+		}
+
+		session.m_rcpts.push_back(recipient);
+		session.m_reply += "250 2.1.5 OK\r\n";
+	}
+	else if (verb == "DATA") {
+		if (!session.m_mail || session.m_rcpts.empty()) {
+			session.m_reply += "554 5.5.1 No valid recipients\r\n";
+			return;
+		}
+
+		session.m_data = true;
+		session.m_dataRemaining = session.m_size;
+		session.m_reply += "354 End data with <CR><LF>.<CR><LF>\r\n";
+	}
+	else if (verb == "RSET") {
+		ResetTransaction(session);
+		session.m_reply += "250 2.0.0 OK\r\n";
+	}
+	else if (verb == "NOOP") {
+		session.m_reply += "250 2.0.0 OK\r\n";
+	}
+	else if (verb == "QUIT") {
+		session.m_quit = true;
+		session.m_reply += "221 2.0.0 Bye\r\n";
+	}
+	else {
+		session.m_reply += "500 5.5.2 Command not recognized\r\n";
+	}
+}
+
+void EmailServerApplication::ResetTransaction(Session& session) {
+	session.m_data = false;
+	session.m_dataRemaining = 0;
+	session.m_mail = false;
+	session.m_size = 0;
+	session.m_rcpts.clear();
+}
+
+void EmailServerApplication::ScheduleReply(Ptr<Socket> socket, Session& session) {
+	NS_LOG_FUNCTION(this << socket);
+
+	if (session.m_reply.empty()) {
+		return;
+	}
+
+	// replies leave in order, so one slow batch holds back the following ones
+	Time delay = session.m_delay + Seconds(m_commandTime->GetValue());
+	session.m_replyTime = std::max(session.m_replyTime, Simulator::Now() + delay);
+	Simulator::Schedule(session.m_replyTime - Simulator::Now(), &EmailServerApplication::SendReply, this, socket, session.m_reply, session.m_quit);
+
+	session.m_reply.clear();
+	session.m_delay = Seconds(0);
+}
+
+void EmailServerApplication::SendReply(Ptr<Socket> socket, std::string reply, bool quit) {
+	NS_LOG_FUNCTION(this << socket);
+
+	Ptr<Packet> packet = Create<Packet>(reinterpret_cast<const uint8_t*>(reply.data()), reply.size());
+
+	if (socket->Send(packet) != static_cast<int>(packet->GetSize())) {
+		NS_LOG_WARN("EmailServerApplication could not send " << reply.size() << " reply bytes");
+	}
+
+	if (quit) {
+		socket->Close();
+		CloseSession(socket);
+	}
+}
+
+void EmailServerApplication::CloseSession(Ptr<Socket> socket) {
+	std::map<Ptr<Socket>, Session>::iterator it = m_sessions.find(socket);
+
+	if (it != m_sessions.end()) {
+		m_peerSessions[it->second.m_peer]--;
+		m_sessions.erase(it);
+	}
+}
+
+void EmailServerApplication::HandlePeerClose(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+
+	CloseSession(socket);
+}
+
+void EmailServerApplication::HandlePeerError(Ptr<Socket> socket) {
+	NS_LOG_FUNCTION(this << socket);
+
+	CloseSession(socket);
+}
+
+} // namespace ns3
@@ -0,0 +1,125 @@
+#ifndef EMAIL_SERVER_APPLICATION_H
+#define EMAIL_SERVER_APPLICATION_H
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+class Socket;
+
+/**
+ * Receiving side of EmailNewsletterApplication: accepts TCP connections and
+ * answers the SMTP commands EHLO, HELO, MAIL, RCPT, DATA, RSET, NOOP and
+ * QUIT. The replies to all commands that arrived together go out in one
+ * packet, as a pipelining server does (RFC 2920).
+ *
+ * A mail body announced with the SIZE parameter of MAIL FROM is skipped
+ * without looking at it, only the terminating "." line is parsed.
+ *
+ * Like a real mail server it limits the connections in total and per
+ * client address (421 at the greeting), the RCPT commands per transaction
+ * (452) and greylists a fraction of the recipients: their first RCPT is
+ * answered with 451 and only a retry after GreylistDelay is accepted.
+ * CommandTime delays every batch of replies and AcceptTime the reply to
+ * the end of a mail body, e.g. for queueing and content scanning.
+ */
+class EmailServerApplication : public Application {
+public:
+	static TypeId GetTypeId(void);
+
+	EmailServerApplication();
+	virtual ~EmailServerApplication();
+
+	uint64_t GetTotalRx(void) const;
+	uint64_t GetTotalMails(void) const;
+	uint64_t GetTotalRecipients(void) const;
+	uint64_t GetUniqueRecipients(void) const;
+	uint64_t GetDuplicateRecipients(void) const;
+	uint64_t GetGreylistedRecipients(void) const;
+	uint64_t GetRefusedConnections(void) const;
+	uint32_t GetMaxSessions(void) const;
+
+protected:
+	virtual void DoDispose(void);
+
+private:
+	/**
+	 * State of one SMTP connection.
+	 */
+	struct Session {
+		Session()
+			: m_peer(0)
+			, m_data(false)
+			, m_dataRemaining(0)
+			, m_mail(false)
+			, m_size(0)
+			, m_quit(false) {}
+
+		uint32_t	m_peer;		//!< IPv4 address of the client
+		std::vector<std::string> m_rcpts;	//!< Accepted recipients of the transaction
+		Time		m_replyTime;	//!< When the last scheduled reply is sent
+		std::string	m_line;		//!< Received bytes not yet ending with CRLF
+		std::string	m_reply;	//!< Replies collected while handling one read
+		bool		m_data;		//!< Between 354 and the "." line
+		uint64_t	m_dataRemaining;	//!< Announced body bytes not received yet
+		bool		m_mail;		//!< MAIL FROM accepted
+		uint64_t	m_size;		//!< SIZE of MAIL FROM
+		Time		m_delay;	//!< Processing time of the replies being collected
+		bool		m_quit;		//!< Close after sending m_reply
+	};
+
+	virtual void StartApplication(void);
+	virtual void StopApplication(void);
+
+	void HandleAccept(Ptr<Socket> socket, const Address& from);
+	void HandleRead(Ptr<Socket> socket);
+	void HandlePeerClose(Ptr<Socket> socket);
+	void HandlePeerError(Ptr<Socket> socket);
+	void HandleLines(Session& session);
+	void HandleLine(Session& session, const std::string& line);
+	void ResetTransaction(Session& session);
+	void ScheduleReply(Ptr<Socket> socket, Session& session);
+	void SendReply(Ptr<Socket> socket, std::string reply, bool quit);
+	void CloseSession(Ptr<Socket> socket);
+
+	Ptr<Socket>	m_socket;	//!< Listening socket
+	Address		m_local;	//!< Local address to bind to
+	TypeId		m_tid;		//!< The type of protocol to use.
+	bool		m_pipelining;	//!< Offer PIPELINING in the EHLO reply
+	uint32_t	m_maxConnections;	//!< 0 for no limit
+	uint32_t	m_maxConnectionsPerPeer;	//!< 0 for no limit
+	uint32_t	m_maxRecipientsPerMail;	//!< 0 for no limit
+	double		m_greylistProbability;
+	Time		m_greylistDelay;
+	Ptr<RandomVariableStream> m_commandTime;
+	Ptr<RandomVariableStream> m_acceptTime;
+	Ptr<UniformRandomVariable> m_random;
+
+	std::map<Ptr<Socket>, Session> m_sessions;
+	std::map<uint32_t, uint32_t> m_peerSessions;	//!< Open sessions per client address
+	std::map<std::string, Time> m_greylist;	//!< Greylisted recipients and when they were first seen
+	std::map<std::string, uint32_t> m_deliveries;	//!< Delivered mails per recipient
+
+	uint64_t	m_totalRx;
+	uint64_t	m_totalMails;
+	uint64_t	m_totalRecipients;
+	uint64_t	m_greylisted;
+	uint64_t	m_refusedConnections;
+	uint32_t	m_maxSessions;	//!< Most sessions open at the same time
+
+	TracedCallback<Ptr<const Packet>, const Address&> m_rxTrace;
+};
+
+} // namespace ns3
+
+#endif /* EMAIL_SERVER_APPLICATION_H */
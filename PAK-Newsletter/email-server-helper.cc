@@ -0,0 +1,44 @@
+#include "email-server-helper.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/string.h"
+#include "ns3/names.h"
+
+namespace ns3 {
+
+EmailServerHelper::EmailServerHelper(std::string protocol, Address address) {
+	m_factory.SetTypeId("ns3::EmailServerApplication");
+	m_factory.Set("Protocol", StringValue(protocol));
+	m_factory.Set("Local", AddressValue(address));
+}
+
+void EmailServerHelper::SetAttribute(std::string name, const AttributeValue &value) {
+	m_factory.Set(name, value);
+}
+
+ApplicationContainer EmailServerHelper::Install(Ptr<Node> node) const {
+	return ApplicationContainer(InstallPriv(node));
+}
+
+ApplicationContainer EmailServerHelper::Install(std::string nodeName) const {
+	Ptr<Node> node = Names::Find<Node>(nodeName);
+
+	return ApplicationContainer(InstallPriv(node));
+}
+
+ApplicationContainer EmailServerHelper::Install(NodeContainer c) const {
+	ApplicationContainer apps;
+	for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i) {
+		apps.Add(InstallPriv(*i));
+	}
+
+	return apps;
+}
+
+Ptr<Application> EmailServerHelper::InstallPriv(Ptr<Node> node) const {
+	Ptr<Application> app = m_factory.Create<Application>();
+	node->AddApplication(app);
+
+	return app;
+}
+
+} // namespace ns3
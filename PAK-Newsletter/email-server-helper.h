@@ -0,0 +1,37 @@
+#ifndef EMAIL_SERVER_HELPER_H
+#define EMAIL_SERVER_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include "ns3/object-factory.h"
+#include "ns3/address.h"
+#include "ns3/attribute.h"
+#include "ns3/net-device.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+
+namespace ns3 {
+
+/**
+ * Installs EmailServerApplication, the SMTP server EmailNewsletterApplication delivers to.
+ */
+class EmailServerHelper {
+public:
+	EmailServerHelper(std::string protocol, Address address);
+
+	void SetAttribute(std::string name, const AttributeValue &value);
+
+	ApplicationContainer Install(NodeContainer c) const;
+	ApplicationContainer Install(Ptr<Node> node) const;
+	ApplicationContainer Install(std::string nodeName) const;
+
+private:
+
+	Ptr<Application> InstallPriv(Ptr<Node> node) const;
+
+	ObjectFactory m_factory; //!< Object factory.
+};
+
+} // namespace ns3
+
+#endif /* EMAIL_SERVER_HELPER_H */
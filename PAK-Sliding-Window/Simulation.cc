@@ -11,16 +11,85 @@
 
 #include "ack-server.h"
 #include "sliding-client.h"
+#include "sliding-window-helper.h"
+#include "sliding-sweep.h"
+#include "../PAK-Common/pak-results.h"
+#include "../PAK-Common/pak-pcap.h"
+#include "../PAK-Common/pak-stats.h"
 
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <cstdlib>
+#include <limits>
+#include <new>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("PakSliding");
 
+bool countAllocations = false;
+uint64_t allocations = 0;
+
+// counts every heap allocation of the process, including the ns-3 libraries, while enabled
+void* operator new(std::size_t size) {
+	if (countAllocations) {
+		allocations++;
+	}
+
+	void* ptr = std::malloc(size > 0 ? size : 1);
+
+	if (ptr == 0) {
+		throw std::bad_alloc();
+	}
+
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+uint64_t segmentSize = 1400;
+uint64_t burstCount = 0;
+uint64_t burstPackets = 0;
+uint32_t burstMax = 0;
+
+void CwndCb(Ptr<OutputStreamWrapper> stream, uint64_t, uint64_t cWnd) {
+	*stream->GetStream() << Simulator::Now().GetSeconds() << "\t" << (cWnd / static_cast<double>(segmentSize)) << std::endl;
+}
+
+void PhaseCb(Ptr<OutputStreamWrapper> stream, SlidingCongestionState::Phase, SlidingCongestionState::Phase phase) {
+	*stream->GetStream() << Simulator::Now().GetSeconds() << "\t" << phase << std::endl;
+}
+
+void CongestionCb(Ptr<OutputStreamWrapper> stream, uint64_t) {
+	*stream->GetStream() << Simulator::Now().GetSeconds() << std::endl;
+}
+
+uint64_t linkBytes[2] = { 0, 0 };
+
+void LinkTxCb(uint64_t* bytes, Ptr<const Packet> packet) {
+	*bytes += packet->GetSize();
+}
+
+void BurstCb(uint32_t packets) {
+	burstCount++;
+	burstPackets += packets;
+	burstMax = std::max(burstMax, packets);
+}
+
 int main(int argc, char *argv[]) {
 	/*
 	 * A (0) ------- R1 (1) ------- R2 (2) ------- R3 (3) ------- R4 (4) ------- B (5)
+	 *
+	 * With more than one flow every flow gets its own client leaf behind A and its own
+	 * server leaf behind B, so all flows see the same path and the same RTT:
+	 *
+	 * C (6) ---\                                                                   /--- S (7)
+	 * C (8) ---- A (0) ---- R1 (1) ---- R2 (2) ---- R3 (3) ---- R4 (4) ---- B (5) ---- S (9)
+	 * ...   ---/                                                                   \--- ...
 	 */
 
 	LogComponentEnable("PakSliding", LOG_LEVEL_INFO);
@@ -28,13 +97,117 @@ int main(int argc, char *argv[]) {
 	uint64_t packetSize = 1400;
 	uint64_t windowSize = 25000;
 	uint64_t runtime = 60;
+	uint32_t flows = 1;
+	double startInterval = 0;
+	double startJitter = 0;
+	std::string timerMode = "PerPacket";
+	std::string retransmitMode = "None";
+	std::string congestionControl = "None";
+	uint64_t pacingBurst = 0;
+	bool burstMode = false;
+	uint32_t maxBurst = 0;
+	uint32_t ackEvery = 1;
+	bool measureAllocations = false;
+	uint32_t sackBlocks = 4;
+	std::string sweep = "";
+	std::string sweepFile = "";
+	std::string sweepOutput = "pak-sliding-sweep.csv";
+	uint32_t seeds = 1;
+	uint32_t jobs = 0;
+	bool sweepWorker = false;
+	PakResults results("PAK-Sliding-Window");
+	PakPcap pcap("pak-sliding");
+	PakFlowStats stats;
 
 	CommandLine cmd;
 	cmd.AddValue("runtime", "Length in seconds to run this simulation", runtime);
+	cmd.AddValue("flows", "Number of client/server pairs sharing the bottleneck", flows);
+	cmd.AddValue("startInterval", "Time in seconds between the starts of two clients", startInterval);
+	cmd.AddValue("startJitter", "Upper bound in seconds of a random delay added to each client's start, drawn from --RngRun", startJitter);
 	cmd.AddValue("packetSize", "Size of one packet in byte", packetSize);
 	cmd.AddValue("windowSize", "Window size in byte", windowSize);
+	cmd.AddValue("timerMode", "Retransmission timer mode of the client (PerPacket, Single)", timerMode);
+	cmd.AddValue("retransmitMode", "Retransmission mode of the client (None, GoBackN, SelectiveRepeat)", retransmitMode);
+	cmd.AddValue("congestionControl", "Congestion control of the client (None, Aimd, Cubic)", congestionControl);
+	cmd.AddValue("pacingBurst", "Depth of the client's pacing token bucket in byte", pacingBurst);
+	cmd.AddValue("burstMode", "Let the client fill the open window in one burst", burstMode);
+	cmd.AddValue("maxBurst", "Maximum number of packets per burst, 0 for no limit", maxBurst);
+	cmd.AddValue("ackEvery", "Number of in-order packets acknowledged by one ACK", ackEvery);
+	cmd.AddValue("sackBlocks", "Maximum number of SACK blocks per ACK", sackBlocks);
+	cmd.AddValue("countAllocations", "Count heap allocations while the simulation runs", measureAllocations);
+	cmd.AddValue("sweep", "Grid of parameters to sweep, e.g. windowSize=10000,25000;packetSize=500,1400", sweep);
+	cmd.AddValue("sweepFile", "File with one set of parameters to sweep per line, e.g. windowSize=10000 packetSize=500", sweepFile);
+	cmd.AddValue("sweepOutput", "CSV file the metrics of all sweep runs are written to", sweepOutput);
+	cmd.AddValue("seeds", "Number of ns-3 run numbers every parameter set of the sweep is run with, only differ with --startJitter", seeds);
+	cmd.AddValue("jobs", "Number of sweep runs in parallel, 0 for one per core", jobs);
+	cmd.AddValue("sweepWorker", "Print the metrics for SlidingSweep and write no trace files", sweepWorker);
+	results.AddOptions(cmd);
+	pcap.AddOptions(cmd);
+	stats.AddOptions(cmd);
 	cmd.Parse(argc, argv);
 
+	if (!sweep.empty() || !sweepFile.empty()) {
+		// without jitter nothing in the scenario is random, every run number would give the same run
+		if (seeds > 1 && startJitter <= 0 && sweep.find("startJitter") == std::string::npos && sweepFile.empty()) {
+			NS_FATAL_ERROR("--seeds needs --startJitter, the runs would be identical otherwise");
+		}
+
+		SlidingSweep sweeper(argv[0]);
+
+		// every other argument is the same for all runs
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			std::string name = arg.substr(0, arg.find('='));
+
+			// the runs' records end up in the sweep output instead of --results, parallel runs would overwrite one --stats file
+			if (name != "--sweep" && name != "--sweepFile" && name != "--sweepOutput" && name != "--seeds" && name != "--jobs" && name != "--results" && name != "--stats") {
+				sweeper.AddArgument(arg);
+			}
+		}
+
+		if (!sweep.empty()) {
+			sweeper.AddGrid(sweep);
+		}
+
+		if (!sweepFile.empty()) {
+			sweeper.AddFile(sweepFile);
+		}
+
+		sweeper.SetSeeds(seeds);
+
+		return sweeper.Run(jobs, sweepOutput) > 0 ? 1 : 0;
+	}
+
+	if (flows == 0) {
+		NS_FATAL_ERROR("At least one flow is required");
+	}
+
+	// the /30 subnets of 10.2.0.0/16 and 10.3.0.0/16 hold 16384 client and server leaves
+	if (flows > 16384) {
+		NS_FATAL_ERROR("At most 16384 flows are supported, not " << flows);
+	}
+
+	// one "name<TAB>value" line per metric when run by SlidingSweep
+	results.SetTabular(sweepWorker);
+	results.SetParameter("runtime", runtime);
+	results.SetParameter("flows", flows);
+	results.SetParameter("startInterval", startInterval);
+	results.SetParameter("startJitter", startJitter);
+	results.SetParameter("packetSize", packetSize);
+	results.SetParameter("windowSize", windowSize);
+	results.SetParameter("timerMode", timerMode);
+	results.SetParameter("retransmitMode", retransmitMode);
+	results.SetParameter("congestionControl", congestionControl);
+	results.SetParameter("pacingBurst", pacingBurst);
+	results.SetParameter("burstMode", burstMode);
+	results.SetParameter("maxBurst", maxBurst);
+	results.SetParameter("ackEvery", ackEvery);
+	results.SetParameter("sackBlocks", sackBlocks);
+	results.SetParameter("pcap", pcap.GetMode());
+	results.SetParameter("pcapSnapLen", pcap.GetSnapLen());
+
+
+	std::clock_t setupStart = std::clock();
 
 	NodeContainer nodes;
 	nodes.Create(6);
@@ -46,8 +219,18 @@ int main(int argc, char *argv[]) {
 	NodeContainer nR4B = NodeContainer(nodes.Get(4), nodes.Get(5));
 
 
+	NodeContainer clientNodes;
+	NodeContainer serverNodes;
+	if (flows > 1) {
+		clientNodes.Create(flows);
+		serverNodes.Create(flows);
+	}
+
+
 	InternetStackHelper internet;
 	internet.Install(nodes);
+	internet.Install(clientNodes);
+	internet.Install(serverNodes);
 
 
 	PointToPointHelper p2p;
@@ -85,50 +268,211 @@ int main(int argc, char *argv[]) {
 	Ipv4InterfaceContainer iR4B = ipv4.Assign(dR4B);
 
 
-	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	std::vector<Address> serverAddresses;
+	if (flows > 1) {
+		// /30 subnets give room for 16384 leaves on each side
+		p2p.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
+		p2p.SetChannelAttribute("Delay", StringValue("1ms"));
+
+		Ipv4AddressHelper clientIpv4;
+		clientIpv4.SetBase("10.2.0.0", "255.255.255.252");
+		Ipv4AddressHelper serverIpv4;
+		serverIpv4.SetBase("10.3.0.0", "255.255.255.252");
+
+		for (uint32_t i = 0; i < flows; i++) {
+			clientIpv4.Assign(p2p.Install(clientNodes.Get(i), nodes.Get(0)));
+			clientIpv4.NewNetwork();
+
+			Ipv4InterfaceContainer iServer = serverIpv4.Assign(p2p.Install(nodes.Get(5), serverNodes.Get(i)));
+			serverIpv4.NewNetwork();
+			serverAddresses.push_back(InetSocketAddress(iServer.GetAddress(1), 9));
+		}
+	}
+	else {
+		clientNodes.Add(nodes.Get(0));
+		serverNodes.Add(nodes.Get(5));
+		serverAddresses.push_back(InetSocketAddress(iR4B.GetAddress(1), 9));
+	}
+
+	// forward direction of both 3 Mbps links
+	dR2R3.Get(0)->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&LinkTxCb, &linkBytes[0]));
+	dR3R4.Get(0)->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&LinkTxCb, &linkBytes[1]));
 
 
-	Ptr<AckServerApplication> ackSrv = Create<AckServerApplication>();
-	nodes.Get(5)->AddApplication(ackSrv);
-	ApplicationContainer ackSrvAppContainer(ackSrv);
+	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
 
-	Ptr<SlidingClient> sldCln = CreateObjectWithAttributes<SlidingClient>(
-		"PacketSize", UintegerValue(packetSize),
-		"WindowSize", UintegerValue(windowSize),
-		"Remote", AddressValue(InetSocketAddress(iR4B.GetAddress(1), 9)),
-		"DataRate", DataRateValue(DataRate("10Mbps"))
-		);
-	nodes.Get(0)->AddApplication(sldCln);
-	ApplicationContainer sldClnAppContainer(sldCln);
+	double topologyTime = (std::clock() - setupStart) / static_cast<double>(CLOCKS_PER_SEC);
+	std::clock_t appStart = std::clock();
+
+	AckServerHelper ackSrvHelper;
+	ackSrvHelper.SetAttribute("AckEvery", UintegerValue(ackEvery));
+	ackSrvHelper.SetAttribute("MaxSackBlocks", UintegerValue(sackBlocks));
+	ApplicationContainer ackSrvAppContainer = ackSrvHelper.Install(serverNodes);
+
+
+	SlidingClientHelper sldClnHelper(serverAddresses[0]);
+	sldClnHelper.SetAttribute("PacketSize", UintegerValue(packetSize));
+	sldClnHelper.SetAttribute("WindowSize", UintegerValue(windowSize));
+	sldClnHelper.SetAttribute("DataRate", DataRateValue(DataRate("10Mbps")));
+	sldClnHelper.SetAttribute("TimerMode", StringValue(timerMode));
+	sldClnHelper.SetAttribute("RetransmitMode", StringValue(retransmitMode));
+	sldClnHelper.SetAttribute("CongestionControl", TypeIdValue(TypeId::LookupByName("ns3::SlidingCongestion" + congestionControl)));
+	sldClnHelper.SetAttribute("PacingBurst", UintegerValue(pacingBurst));
+	sldClnHelper.SetAttribute("BurstMode", BooleanValue(burstMode));
+	sldClnHelper.SetAttribute("MaxBurst", UintegerValue(maxBurst));
+	sldClnHelper.SetStartTimes(Seconds(0), Seconds(startInterval), Seconds(startJitter));
+	ApplicationContainer sldClnAppContainer = sldClnHelper.Install(clientNodes, serverAddresses);
+
+	std::vector<Ptr<AckServerApplication> > ackSrvs;
+	std::vector<Ptr<SlidingClient> > sldClns;
+	ackSrvs.reserve(flows);
+	sldClns.reserve(flows);
+	for (uint32_t i = 0; i < flows; i++) {
+		ackSrvs.push_back(DynamicCast<AckServerApplication>(ackSrvAppContainer.Get(i)));
+		sldClns.push_back(DynamicCast<SlidingClient>(sldClnAppContainer.Get(i)));
+		sldClns[i]->TraceConnectWithoutContext("Burst", MakeCallback(&BurstCb));
+	}
+
+	// traces of the first flow as read by Matlab/plotSlidingMss.m: time in seconds and window in segments,
+	// phase changes as time and SlidingCongestionState::Phase, and the times of congestion events.
+	// parallel sweep runs would overwrite each other's files
+	segmentSize = packetSize;
+	AsciiTraceHelper ascii;
+	if (!sweepWorker) {
+		sldClns[0]->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback(&CwndCb, ascii.CreateFileStream("pak-sliding-cwnd.dat")));
+		sldClns[0]->TraceConnectWithoutContext("SlowStartThreshold", MakeBoundCallback(&CwndCb, ascii.CreateFileStream("pak-sliding-ssthresh.dat")));
+		sldClns[0]->TraceConnectWithoutContext("CongestionPhase", MakeBoundCallback(&PhaseCb, ascii.CreateFileStream("pak-sliding-phase.dat")));
+		sldClns[0]->TraceConnectWithoutContext("CongestionEvent", MakeBoundCallback(&CongestionCb, ascii.CreateFileStream("pak-sliding-congestion.dat")));
+	}
 
 
 	ackSrvAppContainer.Start(Seconds(0));
 	ackSrvAppContainer.Stop(Seconds(runtime + 10));
-	sldClnAppContainer.Start(Seconds(0));
 	sldClnAppContainer.Stop(Seconds(runtime));
 
+	double appTime = (std::clock() - appStart) / static_cast<double>(CLOCKS_PER_SEC);
 
-	p2p.EnablePcapAll("pak-sliding");
 
+	if (!sweepWorker) {
+		pcap.Enable(p2p);
+	}
 
-	Simulator::Stop(Seconds(runtime + 10));
-	Simulator::Run();
+	// bins over the whole run including the 10 s the servers keep running
+	if (stats.IsEnabled()) {
+		stats.Init(Seconds(runtime + 10));
 
+		for (uint32_t i = 0; i < flows; i++) {
+			sldClns[i]->TraceConnectWithoutContext("Tx", MakeCallback(&PakFlowStats::Tx, &stats));
+			sldClns[i]->TraceConnectWithoutContext("RttSample", MakeCallback(&PakFlowStats::Rtt, &stats));
+			ackSrvs[i]->TraceConnectWithoutContext("Rx", MakeCallback(&PakFlowStats::Rx, &stats));
+		}
 
-	std::cout << std::fixed;
-	std::cout << std::endl << std::endl;
-	std::cout << "Simulation run time: " << runtime << "s" << std::endl;
-	std::cout << "Total packets sent: " << sldCln->GetSentPackets() << std::endl;
-	std::cout << "Total packets received: " << ackSrv->GetTotalPacketsReceived() << std::endl;
-	std::cout << "Total packets acknowledged: " << sldCln->GetAckedPackets() << std::endl;
-	std::cout << "Total bytes received: " << ackSrv->GetTotalBytesReceived() << " Byte" << std::endl;
-	std::cout << "Server run time: " << (Simulator::Now() - ackSrv->GetStartTime()).To(Time::S).GetDouble() << "s" << std::endl;
-	std::cout << "Total mean data rate: " << ((ackSrv->GetTotalBytesReceived() * 8.) / (Simulator::Now() - ackSrv->GetStartTime()).To(Time::S).GetDouble()) << " Bit/s" << std::endl;
+		Ptr<Queue> bottleneck = DynamicCast<PointToPointNetDevice>(dR2R3.Get(0))->GetQueue();
+		bottleneck->TraceConnectWithoutContext("Enqueue", MakeCallback(&PakFlowStats::Enqueue, &stats));
+		bottleneck->TraceConnectWithoutContext("Drop", MakeCallback(&PakFlowStats::Drop, &stats));
+	}
+
+
+	Simulator::Stop(Seconds(runtime + 10));
+
+	std::clock_t wallStart = std::clock();
+	results.StartRun();
+	countAllocations = measureAllocations;
+	Simulator::Run();
+	countAllocations = false;
+	results.StopRun();
+	double wallTime = (std::clock() - wallStart) / static_cast<double>(CLOCKS_PER_SEC);
+
+
+	uint64_t sentPackets = 0;
+	uint64_t retransmittedPackets = 0;
+	uint64_t ackedPackets = 0;
+	uint64_t timerEvents = 0;
+	uint64_t sendEvents = 0;
+	uint64_t receivedPackets = 0;
+	uint64_t receivedBytes = 0;
+	uint64_t duplicates = 0;
+	uint64_t outOfOrder = 0;
+	uint64_t reorderHistogram[AckServerFlow::REORDER_BINS] = { 0 };
+	uint64_t acksSent = 0;
+	double goodputSum = 0;
+	double goodputSquareSum = 0;
+	double serverTime = (Simulator::Now() - ackSrvs[0]->GetStartTime()).To(Time::S).GetDouble();
+
+	if (!sweepWorker) {
+		std::cout << std::endl << std::endl;
+	}
+
+	for (uint32_t i = 0; i < flows; i++) {
+		sentPackets += sldClns[i]->GetSentPackets();
+		retransmittedPackets += sldClns[i]->GetRetransmittedPackets();
+		ackedPackets += sldClns[i]->GetAckedPackets();
+		timerEvents += sldClns[i]->GetTimerEvents();
+		sendEvents += sldClns[i]->GetSendEvents();
+		receivedPackets += ackSrvs[i]->GetTotalPacketsReceived();
+		receivedBytes += ackSrvs[i]->GetTotalBytesReceived();
+		duplicates += ackSrvs[i]->GetTotalDuplicatesReceived();
+		outOfOrder += ackSrvs[i]->GetTotalOutOfOrderReceived();
+
+		for (uint32_t bin = 0; bin < AckServerFlow::REORDER_BINS; bin++) {
+			reorderHistogram[bin] += ackSrvs[i]->GetReorderHistogram(bin);
+		}
+		acksSent += ackSrvs[i]->GetTotalAcksSent();
+
+		// each client sends from its staggered start until runtime, late ones must not be rated over the whole run
+		TimeValue startTime;
+		sldClns[i]->GetAttribute("StartTime", startTime);
+		double activeTime = runtime - startTime.Get().GetSeconds();
+		double goodput = activeTime > 0 ? (ackSrvs[i]->GetTotalBytesReceived() * 8.) / activeTime : 0.;
+		goodputSum += goodput;
+		goodputSquareSum += goodput * goodput;
+
+		results.AddMetric("Flow " + std::to_string(i) + " goodput", goodput, " Bit/s");
+	}
+
+	// Jain's fairness index, 1 if all flows get the same goodput and 1/n if one flow gets everything
+	double fairness = goodputSquareSum > 0 ? (goodputSum * goodputSum) / (flows * goodputSquareSum) : 0.;
+
+	results.AddMetric("Simulation run time", runtime, "s");
+	results.AddMetric("Flows", flows);
+	results.AddMetric("Total packets sent", sentPackets);
+	results.AddMetric("Total packets retransmitted", retransmittedPackets);
+	results.AddMetric("Total packets received", receivedPackets);
+	results.AddMetric("Total duplicate packets received", duplicates);
+	results.AddMetric("Total out-of-order packets received", outOfOrder);
+	for (uint32_t bin = 0; bin < AckServerFlow::REORDER_BINS; bin++) {
+		results.AddMetric("Reordering distance " + std::to_string(1 << bin) + (bin + 1 < AckServerFlow::REORDER_BINS ? "-" + std::to_string((2 << bin) - 1) : "+"), reorderHistogram[bin]);
+	}
+	results.AddMetric("Total packets acknowledged", ackedPackets);
+	results.AddMetric("Total ACKs sent", acksSent);
+	results.AddMetric("Total unique bytes received", receivedBytes, " Byte");
+	results.AddMetric("Server run time", serverTime, "s");
+	results.AddMetric("Total timer events scheduled", timerEvents);
+	results.AddMetric("Total send events scheduled", sendEvents);
+	results.AddMetric("Mean burst size", (burstCount > 0 ? burstPackets / static_cast<double>(burstCount) : 0.), " packets");
+	results.AddMetric("Max burst size", burstMax, " packets");
+	// null unless counted, the columns stay the same either way
+	double unmeasured = std::numeric_limits<double>::quiet_NaN();
+	results.AddMetric("Heap allocations during run", (measureAllocations ? static_cast<double>(allocations) : unmeasured));
+	results.AddMetric("Heap allocations per acknowledged packet", (measureAllocations ? (ackedPackets > 0 ? allocations / static_cast<double>(ackedPackets) : 0.) : unmeasured));
+
+	results.AddMetric("Topology setup CPU time", topologyTime, "s");
+	results.AddMetric("Application setup CPU time", appTime, "s");
+	results.AddMetric("Application setup CPU time per flow", appTime * 1e6 / flows, "us");
+	results.AddMetric("Simulation CPU time", wallTime, "s");
+	results.AddMetric("Total mean data rate", goodputSum, " Bit/s");
+	results.AddMetric("Jain's fairness index", fairness);
+	// the clients only send during the first runtime seconds
+	results.AddMetric("Utilisation R2-R3", (linkBytes[0] * 8. / (3e6 * runtime)) * 100, "%");
+	results.AddMetric("Utilisation R3-R4", (linkBytes[1] * 8. / (3e6 * runtime)) * 100, "%");
+	stats.Write(results);
 
 
 	Simulator::Destroy();
 
+	results.Write();
+
 
 	return 0;
 }
@@ -7,16 +7,69 @@
 #include "ns3/address.h"
 #include "ns3/application.h"
 #include "ns3/udp-socket-factory.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/log.h"
+#include "ns3/double.h"
+
+#include <cmath>
+#include <algorithm>
 
 namespace ns3 {
 
+NS_LOG_COMPONENT_DEFINE("AckServerApplication");
 NS_OBJECT_ENSURE_REGISTERED(AckServerApplication);
 
+const uint32_t AckServerApplication::NO_FLOW;
+const uint32_t AckServerFlow::REORDER_BINS;
+const uint32_t AckServerDataRate::RATE_BUCKETS;
+
 TypeId AckServerApplication::GetTypeId(void) {
 	static TypeId tid = TypeId("ns3::AckServerApplication")
 		.SetParent<Application>()
 		.SetGroupName("Applications")
 		.AddConstructor<AckServerApplication>()
+		.AddAttribute("Port", "Port on which the server listens for packets.",
+			UintegerValue(9),
+			MakeUintegerAccessor(&AckServerApplication::m_port),
+			MakeUintegerChecker<uint16_t>())
+		.AddAttribute("ExpectedPeers", "Number of peers the flow table is sized for, it grows beyond that on demand.",
+			UintegerValue(64),
+			MakeUintegerAccessor(&AckServerApplication::m_expectedPeers),
+			MakeUintegerChecker<uint32_t>(1, 1 << 30))
+		.AddAttribute("AckEvery", "Number of in-order packets acknowledged by one ACK.",
+			UintegerValue(1),
+			MakeUintegerAccessor(&AckServerApplication::m_ackEvery),
+			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("AckDelay", "Maximum time an in-order packet waits for its delayed ACK.",
+			TimeValue(MilliSeconds(40)),
+			MakeTimeAccessor(&AckServerApplication::m_ackDelay),
+			MakeTimeChecker())
+		.AddAttribute("MaxSackBlocks", "Maximum number of SACK blocks per ACK, 0 sends cumulative ACKs only.",
+			UintegerValue(4),
+			MakeUintegerAccessor(&AckServerApplication::m_maxSackBlocks),
+			MakeUintegerChecker<uint32_t>(0, 255))
+		.AddAttribute("MaxReceiveWindow", "Maximum distance in packets above the next expected sequence number the receive bitmap tracks, packets beyond are dropped.",
+			UintegerValue(65536),
+			MakeUintegerAccessor(&AckServerApplication::m_maxReceiveWindow),
+			MakeUintegerChecker<uint32_t>(64))
+		.AddAttribute("RateAlpha", "Weight of the newest sample in the moving average of the data rate.",
+			DoubleValue(0.125),
+			MakeDoubleAccessor(&AckServerApplication::m_rateAlpha),
+			MakeDoubleChecker<double>(0.0, 1.0))
+		.AddAttribute("RateInterval", "Length of the sliding window of the data rate estimator, the moving average is sampled every RateInterval / 8.",
+			TimeValue(Seconds(1)),
+			MakeTimeAccessor(&AckServerApplication::m_rateInterval),
+			MakeTimeChecker(NanoSeconds(AckServerDataRate::RATE_BUCKETS)))
+		.AddTraceSource("MeanDataRate", "Exponentially weighted moving average of the received data rate",
+			MakeTraceSourceAccessor(&AckServerApplication::m_meanDataRateTrace),
+			"ns3::TracedValueCallback::DataRate")
+		.AddTraceSource("WindowDataRate", "Received data rate over the last RateInterval",
+			MakeTraceSourceAccessor(&AckServerApplication::m_windowDataRateTrace),
+			"ns3::TracedValueCallback::DataRate")
+		.AddTraceSource("Rx", "A packet has been received",
+			MakeTraceSourceAccessor(&AckServerApplication::m_rxTrace),
+			"ns3::Packet::AddressTracedCallback")
 		;
 
 	return tid;
@@ -24,17 +77,26 @@ TypeId AckServerApplication::GetTypeId(void) {
 
 AckServerApplication::AckServerApplication(void)
 	: m_socket(NULL)
+	, m_port(9)
 	, m_totalPacketsReceived(0)
 	, m_totalBytesReceived(0)
-	, m_meanDataRate(0)
-	, m_dataRate0(0)
-	, m_dataRate1(0)
-	, m_dataRate2(0) {}
+	, m_totalDuplicates(0)
+	, m_totalOutOfOrder(0)
+	, m_rateAlpha(0.125)
+	, m_rateInterval(Seconds(1))
+	, m_ackEvery(1)
+	, m_ackDelay(MilliSeconds(40))
+	, m_maxSackBlocks(4)
+	, m_maxReceiveWindow(65536)
+	, m_expectedPeers(64)
+	, m_flowMask(0)
+	, m_totalAcksSent(0) {
+	std::fill(m_reorderHistogram, m_reorderHistogram + AckServerFlow::REORDER_BINS, 0);
+}
 
 AckServerApplication::~AckServerApplication(void) {}
 
 
-
 Time AckServerApplication::GetStartTime(void) {
 	return m_startTime;
 }
@@ -47,8 +109,60 @@ uint64_t AckServerApplication::GetTotalBytesReceived(void) {
 	return m_totalBytesReceived;
 }
 
+uint64_t AckServerApplication::GetTotalDuplicatesReceived(void) {
+	return m_totalDuplicates;
+}
+
+uint64_t AckServerApplication::GetTotalOutOfOrderReceived(void) {
+	return m_totalOutOfOrder;
+}
+
+uint64_t AckServerApplication::GetReorderHistogram(uint32_t bin) {
+	NS_ASSERT(bin < AckServerFlow::REORDER_BINS);
+
+	return m_reorderHistogram[bin];
+}
+
 uint64_t AckServerApplication::GetMeanDataRate(void) {
-	return m_meanDataRate;
+	m_dataRate.Roll(Simulator::Now());
+	UpdateDataRateTraces();
+
+	return m_dataRate.GetMeanDataRate();
+}
+
+uint64_t AckServerApplication::GetWindowDataRate(void) {
+	m_dataRate.Roll(Simulator::Now());
+	UpdateDataRateTraces();
+
+	return m_dataRate.GetWindowDataRate();
+}
+
+uint64_t AckServerApplication::GetTotalAcksSent(void) {
+	return m_totalAcksSent;
+}
+
+uint32_t AckServerApplication::GetFlowCount(void) {
+	return m_flows.size();
+}
+
+const AckServerFlow& AckServerApplication::GetFlow(uint32_t i) {
+	NS_ASSERT(i < m_flows.size());
+
+	// bring the rate estimate up to now before handing it out
+	m_flows[i].m_dataRate.Roll(Simulator::Now());
+
+	return m_flows[i];
+}
+
+const AckServerFlow* AckServerApplication::FindFlow(const Address& peer) {
+	uint32_t slot;
+	uint32_t index = FindFlowIndex(peer, slot);
+
+	if (index == NO_FLOW) {
+		return NULL;
+	}
+
+	return &GetFlow(index);
 }
 
 void AckServerApplication::Reset(void) {
@@ -60,34 +174,72 @@ void AckServerApplication::Reset(void) {
 
 void AckServerApplication::ResetStartTime(void) {
 	m_startTime = Simulator::Now();
+
+	for (std::vector<AckServerFlow>::iterator it = m_flows.begin(); it != m_flows.end(); ++it) {
+		it->m_startTime = m_startTime;
+	}
 }
 
 void AckServerApplication::ResetTotalPacketsReceived(void) {
 	m_totalPacketsReceived = 0;
+	m_totalDuplicates = 0;
+	m_totalOutOfOrder = 0;
+	std::fill(m_reorderHistogram, m_reorderHistogram + AckServerFlow::REORDER_BINS, 0);
+
+	for (std::vector<AckServerFlow>::iterator it = m_flows.begin(); it != m_flows.end(); ++it) {
+		it->m_packetsReceived = 0;
+		it->m_duplicates = 0;
+		it->m_outOfOrder = 0;
+		std::fill(it->m_reorderHistogram, it->m_reorderHistogram + AckServerFlow::REORDER_BINS, 0);
+	}
 }
 
 void AckServerApplication::ResetTotalBytesReceived(void) {
 	m_totalBytesReceived = 0;
+
+	for (std::vector<AckServerFlow>::iterator it = m_flows.begin(); it != m_flows.end(); ++it) {
+		it->m_bytesReceived = 0;
+	}
 }
 
 void AckServerApplication::ResetDataRate(void) {
-	m_meanDataRate = 0;
-	m_dataRate0 = 0;
-	m_dataRate1 = 0;
-	m_dataRate2 = 0;
+	m_dataRate.Reset(m_rateAlpha, m_rateInterval, Simulator::Now());
+	m_meanDataRateTrace = DataRate(0);
+	m_windowDataRateTrace = DataRate(0);
+
+	for (std::vector<AckServerFlow>::iterator it = m_flows.begin(); it != m_flows.end(); ++it) {
+		it->m_dataRate.Reset(m_rateAlpha, m_rateInterval, Simulator::Now());
+	}
 }
 
 void AckServerApplication::StartApplication(void) {
 	m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
-	InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), 9);
+	InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
 	m_socket->Bind(local);
 	m_socket->SetRecvCallback(MakeCallback(&AckServerApplication::HandleRead, this));
+	m_ackTemplate = Create<Packet>();
+
+	// at most half of the slots are used, which keeps the probe sequences short
+	uint32_t slots = 1;
+	while (slots < 2 * m_expectedPeers) {
+		slots <<= 1;
+	}
+
+	m_flows.reserve(m_expectedPeers);
+	m_flowSlots.assign(slots, NO_FLOW);
+	m_flowMask = slots - 1;
 
 	m_startTime = Simulator::Now();
-	m_lastPacketTime = Simulator::Now();
+	ResetDataRate();
 }
 
 void AckServerApplication::StopApplication(void) {
+	Simulator::Cancel(m_rollEvent);
+
+	for (std::vector<AckServerFlow>::iterator it = m_flows.begin(); it != m_flows.end(); ++it) {
+		Simulator::Cancel(it->m_delayedAckEvent);
+	}
+
 	m_socket->Close();
 }
 
@@ -96,26 +248,532 @@ void AckServerApplication::HandleRead(Ptr<Socket> socket) {
 	Address from;
 
 	while ((packet = socket->RecvFrom(from))) {
-		++m_totalPacketsReceived;
-		m_totalBytesReceived += packet->GetSize();
+		uint32_t size = packet->GetSize();
+
+		m_rxTrace(packet, from);
+
+		PacketSeqHeader h;
+
+		if (size < h.GetSerializedSize()) {
+			NS_LOG_WARN("AckServerApplication received packet without sequence header from " << from);
+			continue;
+		}
+
+		packet->RemoveHeader(h);
+
+		uint32_t index = GetFlowIndex(from);
+		AckServerFlow& flow = m_flows[index];
+		uint64_t distance;
+
+		// holes the sender gave up on would otherwise stall the window for good
+		flow.m_receiveWindow.Advance(h.GetWindowHead());
+
+		uint64_t receivedEnd = flow.m_receiveWindow.GetReceivedEnd();
+
+		AckServerReceiveWindow::Result result = flow.m_receiveWindow.Receive(h.GetSeq(), distance);
+
+		if (result == AckServerReceiveWindow::RECEIVED_BEYOND_WINDOW) {
+			NS_LOG_WARN("AckServerApplication dropped sequence number " << h.GetSeq() << " beyond the receive window of " << from);
+			continue;
+		}
+
+		if (result == AckServerReceiveWindow::RECEIVED_DUPLICATE) {
+			flow.m_duplicates++;
+			m_totalDuplicates++;
+		}
+		else {
+			// only the first copy counts towards the received packets and the goodput
+			m_totalPacketsReceived++;
+			flow.m_packetsReceived++;
+			m_totalBytesReceived += size;
+			CalcMeanDataRate(packet);
+			flow.m_bytesReceived += size;
+			flow.m_dataRate.Add(Simulator::Now(), size);
+
+			if (result == AckServerReceiveWindow::RECEIVED_REORDERED) {
+				CountReorder(flow, distance);
+			}
+
+			if (h.GetSeq() > flow.m_receiveWindow.GetNextExpectedSeq()) {
+				flow.m_lastSackSeq = h.GetSeq();
+			}
+		}
+
+		flow.m_pendingAcks++;
+
+		// reordered and duplicate packets and packets opening a new gap are acknowledged right
+		// away, like TCP does, packets above an old gap only extend its SACK block and may wait
+		if (result != AckServerReceiveWindow::RECEIVED_NEW || h.GetSeq() > receivedEnd || flow.m_pendingAcks >= m_ackEvery) {
+			SendAck(index);
+		}
+		else if (!flow.m_delayedAckEvent.IsRunning()) {
+			flow.m_delayedAckEvent = Simulator::Schedule(m_ackDelay, &AckServerApplication::SendAck, this, index);
+		}
+	}
+}
+
+void AckServerApplication::CountReorder(AckServerFlow& flow, uint64_t distance) {
+	uint32_t bin = 0;
+
+	while (bin + 1 < AckServerFlow::REORDER_BINS && (distance >> (bin + 1)) > 0) {
+		bin++;
+	}
+
+	flow.m_outOfOrder++;
+	flow.m_reorderHistogram[bin]++;
+	m_totalOutOfOrder++;
+	m_reorderHistogram[bin]++;
+}
+
+void AckServerApplication::SendAck(uint32_t index) {
+	AckServerFlow& flow = m_flows[index];
+	const AckServerReceiveWindow& window = flow.m_receiveWindow;
+
+	Simulator::Cancel(flow.m_delayedAckEvent);
+
+	if (flow.m_pendingAcks == 0) {
+		return;
+	}
+
+	PacketAckHeader& h = m_ackHeader;
+	h.SetCumulativeAck(window.GetNextExpectedSeq());
+	h.ClearSackBlocks();
+
+	if (m_maxSackBlocks > 0 && window.HasGap()) {
+		// RFC 2018: the first block reports the most recently received packet
+		uint64_t recentStart;
+		uint64_t recentEnd;
+
+		if (!window.FindRange(flow.m_lastSackSeq, recentStart, recentEnd)) {
+			recentStart = window.FindNext(window.GetNextExpectedSeq(), true);
+			recentEnd = window.FindNext(recentStart, false);
+		}
 
-		CalcMeanDataRate(packet);
+		h.AddSackBlock(recentStart, recentEnd);
 
-		// use the UUID as sequence number and send it back as ACK
-		PacketSeqHeader h(packet->GetUid());
+		uint64_t start = window.FindNext(window.GetNextExpectedSeq(), true);
 
-		Ptr<Packet> reply = Create<Packet>();
-		reply->AddHeader(h);
-		socket->SendTo(reply, 0, from);
+		while (h.GetSackBlockCount() < m_maxSackBlocks && window.HasGap()) {
+			uint64_t end = window.FindNext(start, false);
+
+			if (start == end) {
+				break;
+			}
+
+			if (start != recentStart) {
+				h.AddSackBlock(start, end);
+			}
+
+			start = window.FindNext(end, true);
+		}
 	}
+
+	Ptr<Packet> reply = m_ackTemplate->Copy();
+	reply->AddHeader(h);
+	m_socket->SendTo(reply, 0, flow.m_peer);
+
+	flow.m_pendingAcks = 0;
+	m_totalAcksSent++;
 }
 
 uint64_t AckServerApplication::CalcMeanDataRate(Ptr<Packet> currentPacket) {
-	// TODO: implement moving average
+	m_dataRate.Add(Simulator::Now(), currentPacket->GetSize());
+	UpdateDataRateTraces();
+
+	if (!m_rollEvent.IsRunning()) {
+		m_rollEvent = Simulator::Schedule(m_dataRate.GetBucketLength(), &AckServerApplication::RollDataRate, this);
+	}
+
+	return m_dataRate.GetMeanDataRate();
+}
+
+void AckServerApplication::RollDataRate(void) {
+	m_dataRate.Roll(Simulator::Now());
+	UpdateDataRateTraces();
+
+	// once the window is empty the next packet restarts the timer
+	if (m_dataRate.GetWindowDataRate() > 0) {
+		m_rollEvent = Simulator::Schedule(m_dataRate.GetBucketLength(), &AckServerApplication::RollDataRate, this);
+	}
+}
+
+void AckServerApplication::UpdateDataRateTraces(void) {
+	m_meanDataRateTrace = DataRate(m_dataRate.GetMeanDataRate());
+	m_windowDataRateTrace = DataRate(m_dataRate.GetWindowDataRate());
+}
+
+uint32_t AckServerApplication::HashAddress(const Address& address) {
+	uint8_t buffer[Address::MAX_SIZE + 2];
+	uint32_t length = address.CopyAllTo(buffer, sizeof(buffer));
+
+	// FNV-1a over type, length and bytes of the address
+	uint32_t hash = 2166136261u;
+
+	for (uint32_t i = 0; i < length; i++) {
+		hash = (hash ^ buffer[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+uint32_t AckServerApplication::FindFlowIndex(const Address& peer, uint32_t& slot) {
+	if (m_flowSlots.empty()) {
+		return NO_FLOW;
+	}
+
+	slot = HashAddress(peer) & m_flowMask;
+
+	while (m_flowSlots[slot] != NO_FLOW) {
+		if (m_flows[m_flowSlots[slot]].m_peer == peer) {
+			return m_flowSlots[slot];
+		}
+
+		slot = (slot + 1) & m_flowMask;
+	}
+
+	return NO_FLOW;
+}
 
-	m_lastPacketTime = Simulator::Now();
+uint32_t AckServerApplication::GetFlowIndex(const Address& peer) {
+	uint32_t slot;
+	uint32_t index = FindFlowIndex(peer, slot);
 
-	return 0;
+	if (index != NO_FLOW) {
+		return index;
+	}
+
+	if (2 * (m_flows.size() + 1) > m_flowSlots.size()) {
+		GrowFlowTable();
+		FindFlowIndex(peer, slot);
+	}
+
+	index = m_flows.size();
+	m_flows.push_back(AckServerFlow(peer, m_maxReceiveWindow));
+	m_flows[index].m_startTime = Simulator::Now();
+	m_flows[index].m_dataRate.Reset(m_rateAlpha, m_rateInterval, Simulator::Now());
+	m_flowSlots[slot] = index;
+
+	NS_LOG_INFO("AckServerApplication added flow " << index << " for " << peer);
+
+	return index;
+}
+
+void AckServerApplication::GrowFlowTable(void) {
+	std::vector<uint32_t> slots(m_flowSlots.size() * 2, NO_FLOW);
+	m_flowSlots.swap(slots);
+	m_flowMask = m_flowSlots.size() - 1;
+
+	for (uint32_t i = 0; i < m_flows.size(); i++) {
+		uint32_t slot = HashAddress(m_flows[i].m_peer) & m_flowMask;
+
+		while (m_flowSlots[slot] != NO_FLOW) {
+			slot = (slot + 1) & m_flowMask;
+		}
+
+		m_flowSlots[slot] = i;
+	}
+}
+
+
+AckServerFlow::AckServerFlow(const Address& peer, uint32_t maxReceiveWindow)
+	: m_peer(peer)
+	, m_packetsReceived(0)
+	, m_bytesReceived(0)
+	, m_duplicates(0)
+	, m_outOfOrder(0)
+	, m_receiveWindow(maxReceiveWindow)
+	, m_lastSackSeq(0)
+	, m_pendingAcks(0) {
+	std::fill(m_reorderHistogram, m_reorderHistogram + REORDER_BINS, 0);
+}
+
+
+AckServerReceiveWindow::AckServerReceiveWindow(uint32_t maxSize)
+	: m_words(1, 0)
+	, m_mask(63)
+	, m_base(0)
+	, m_highest(0)
+	, m_topStart(0)
+	, m_belowStart(0)
+	, m_belowEnd(0)
+	, m_maxSize(maxSize) {}
+
+/**
+ * Index of the lowest set bit, word must not be 0.
+ */
+static inline uint32_t CountTrailingZeros(uint64_t word) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	uint32_t count = 0;
+
+	while (!(word & 1)) {
+		word >>= 1;
+		count++;
+	}
+
+	return count;
+#endif
+}
+
+AckServerReceiveWindow::Result AckServerReceiveWindow::Receive(uint64_t seq, uint64_t& distance) {
+	distance = 0;
+
+	if (seq < m_base) {
+		return RECEIVED_DUPLICATE;
+	}
+
+	if (seq - m_base > m_mask && !Grow(seq)) {
+		return RECEIVED_BEYOND_WINDOW;
+	}
+
+	if (Test(seq)) {
+		return RECEIVED_DUPLICATE;
+	}
+
+	Result result = RECEIVED_NEW;
+
+	if (seq < m_highest) {
+		distance = m_highest - 1 - seq;
+		result = RECEIVED_REORDERED;
+	}
+	else {
+		// a new gap below seq starts a new top range, the old one is kept as the range below it
+		if (seq > m_highest && m_highest > m_base) {
+			m_belowStart = m_topStart;
+			m_belowEnd = m_highest;
+			m_topStart = seq;
+		}
+		else if (m_highest == m_base) {
+			m_topStart = seq;
+		}
+
+		m_highest = seq + 1;
+	}
+
+	if (seq == m_base) {
+		m_base++;
+		SkipReceived();
+	}
+	else {
+		Set(seq);
+
+		// the searches only cover ranges that were not tracked, each of them is merged in once
+		if (seq + 1 == m_topStart) {
+			m_topStart = seq;
+
+			if (seq == m_belowEnd) {
+				m_topStart = m_belowStart;
+				m_belowStart = 0;
+				m_belowEnd = 0;
+			}
+
+			while (m_topStart - 1 > m_base && Test(m_topStart - 1)) {
+				m_topStart--;
+			}
+		}
+		else if (seq == m_belowEnd) {
+			m_belowEnd = FindNext(seq, false);
+		}
+		else if (seq + 1 == m_belowStart) {
+			m_belowStart = seq;
+
+			while (m_belowStart - 1 > m_base && Test(m_belowStart - 1)) {
+				m_belowStart--;
+			}
+		}
+	}
+
+	return result;
+}
+
+void AckServerReceiveWindow::Advance(uint64_t seq) {
+	if (seq <= m_base) {
+		return;
+	}
+
+	// every sequence number passes the base once, so this is O(1) amortised as well
+	while (m_base < seq && m_base < m_highest) {
+		Clear(m_base);
+		m_base++;
+	}
+
+	m_base = seq;
+	m_highest = std::max(m_highest, m_base);
+	SkipReceived();
+}
+
+void AckServerReceiveWindow::SkipReceived(void) {
+	// every bit is set once and cleared once, so advancing is O(1) amortised
+	while (m_base < m_highest && Test(m_base)) {
+		Clear(m_base);
+		m_base++;
+	}
+}
+
+uint64_t AckServerReceiveWindow::FindNext(uint64_t from, bool received) const {
+	uint64_t seq = std::max(from, m_base);
+
+	while (seq < m_highest) {
+		uint64_t bit = seq & m_mask;
+		uint64_t word = m_words[bit >> 6];
+
+		if (!received) {
+			word = ~word;
+		}
+
+		word >>= bit & 63;
+
+		if (word != 0) {
+			return std::min(seq + CountTrailingZeros(word), m_highest);
+		}
+
+		seq += 64 - (bit & 63);
+	}
+
+	return m_highest;
+}
+
+bool AckServerReceiveWindow::FindRange(uint64_t seq, uint64_t& start, uint64_t& end) const {
+	if (seq <= m_base || seq >= m_highest || !Test(seq)) {
+		return false;
+	}
+
+	// the most recent packet is nearly always in the top range or the one below it, which are known without searching
+	if (seq >= m_topStart) {
+		start = m_topStart;
+		end = m_highest;
+
+		return true;
+	}
+
+	if (seq >= m_belowStart && seq < m_belowEnd) {
+		start = m_belowStart;
+		end = m_belowEnd;
+
+		return true;
+	}
+
+	start = seq;
+
+	while (Test(start - 1)) {
+		start--;
+	}
+
+	end = FindNext(seq, false);
+
+	return true;
+}
+
+bool AckServerReceiveWindow::Test(uint64_t seq) const {
+	uint64_t bit = seq & m_mask;
+
+	return (m_words[bit >> 6] >> (bit & 63)) & 1;
+}
+
+void AckServerReceiveWindow::Set(uint64_t seq) {
+	uint64_t bit = seq & m_mask;
+	m_words[bit >> 6] |= static_cast<uint64_t>(1) << (bit & 63);
+}
+
+void AckServerReceiveWindow::Clear(uint64_t seq) {
+	uint64_t bit = seq & m_mask;
+	m_words[bit >> 6] &= ~(static_cast<uint64_t>(1) << (bit & 63));
+}
+
+bool AckServerReceiveWindow::Grow(uint64_t seq) {
+	if (seq - m_base >= m_maxSize) {
+		return false;
+	}
+
+	uint64_t size = m_mask + 1;
+
+	while (seq - m_base >= size) {
+		size <<= 1;
+	}
+
+	AckServerReceiveWindow grown(m_maxSize);
+	grown.m_words.assign(size / 64, 0);
+	grown.m_mask = size - 1;
+	grown.m_base = m_base;
+	grown.m_highest = m_highest;
+
+	for (uint64_t i = FindNext(m_base, true); i < m_highest; i = FindNext(i + 1, true)) {
+		grown.Set(i);
+	}
+
+	m_words.swap(grown.m_words);
+	m_mask = grown.m_mask;
+
+	return true;
+}
+
+
+AckServerDataRate::AckServerDataRate()
+	: m_alpha(0.125)
+	, m_interval(Seconds(1))
+	, m_bucket(0)
+	, m_ewmaDataRate(0)
+	, m_meanDataRate(0)
+	, m_windowDataRate(0) {
+	std::fill(m_buckets, m_buckets + RATE_BUCKETS, 0);
+}
+
+void AckServerDataRate::Reset(double alpha, Time interval, Time now) {
+	m_alpha = alpha;
+	m_interval = interval;
+	m_startTime = now;
+	m_bucketStart = now;
+	m_bucket = 0;
+	std::fill(m_buckets, m_buckets + RATE_BUCKETS, 0);
+
+	m_ewmaDataRate = 0;
+	m_meanDataRate = 0;
+	m_windowDataRate = 0;
+}
+
+void AckServerDataRate::Add(Time now, uint64_t bytes) {
+	Roll(now);
+	m_buckets[m_bucket] += bytes;
+	UpdateWindowDataRate(now);
+}
+
+void AckServerDataRate::Roll(Time now) {
+	Time bucketLength = m_interval / RATE_BUCKETS;
+
+	if (now >= m_bucketStart + bucketLength) {
+		uint64_t elapsed = (now - m_bucketStart).GetTimeStep() / bucketLength.GetTimeStep();
+
+		// close the current bucket, every further elapsed bucket was empty and only decays the average
+		double sample = m_buckets[m_bucket] * 8 / bucketLength.GetSeconds();
+		m_ewmaDataRate = m_alpha * sample + (1 - m_alpha) * m_ewmaDataRate;
+		m_ewmaDataRate *= std::pow(1 - m_alpha, static_cast<double>(elapsed - 1));
+
+		for (uint64_t i = 0; i < elapsed && i < RATE_BUCKETS; i++) {
+			m_bucket = (m_bucket + 1) % RATE_BUCKETS;
+			m_buckets[m_bucket] = 0;
+		}
+
+		m_bucketStart += bucketLength * elapsed;
+
+		m_meanDataRate = m_ewmaDataRate;
+	}
+
+	// the window loses old data with time, not only with new data
+	UpdateWindowDataRate(now);
+}
+
+void AckServerDataRate::UpdateWindowDataRate(Time now) {
+	// the current bucket is only partially filled, count the time covered so far
+	Time bucketLength = m_interval / RATE_BUCKETS;
+	Time covered = Min(m_interval - bucketLength + (now - m_bucketStart), now - m_startTime);
+	uint64_t windowBytes = 0;
+
+	for (uint32_t i = 0; i < RATE_BUCKETS; i++) {
+		windowBytes += m_buckets[i];
+	}
+
+	m_windowDataRate = covered.IsStrictlyPositive() ? windowBytes * 8 / covered.GetSeconds() : 0;
 }
 
 
@@ -123,25 +781,28 @@ NS_OBJECT_ENSURE_REGISTERED(PacketSeqHeader);
 
 PacketSeqHeader::~PacketSeqHeader() {}
 
-PacketSeqHeader::PacketSeqHeader(uint64_t seq)
-	: m_seq(seq) {}
+PacketSeqHeader::PacketSeqHeader(uint64_t seq, uint64_t windowHead)
+	: m_seq(seq)
+	, m_windowHead(windowHead) {}
 
 uint32_t PacketSeqHeader::Deserialize(Buffer::Iterator start) {
-	m_seq = start.ReadU64();
+	m_seq = start.ReadNtohU64();
+	m_windowHead = start.ReadNtohU64();
 
-	return 8;
+	return 16;
 }
 
 uint32_t PacketSeqHeader::GetSerializedSize(void) const {
-	return 8;
+	return 16;
 }
 
 void PacketSeqHeader::Print(std::ostream &os) const {
-	os << m_seq;
+	os << m_seq << " head=" << m_windowHead;
 }
 
 void PacketSeqHeader::Serialize(Buffer::Iterator start) const {
-	start.WriteU64(m_seq);
+	start.WriteHtonU64(m_seq);
+	start.WriteHtonU64(m_windowHead);
 }
 
 TypeId PacketSeqHeader::GetTypeId(void) {
@@ -158,4 +819,71 @@ TypeId PacketSeqHeader::GetInstanceTypeId(void) const {
 	return GetTypeId();
 }
 
+
+NS_OBJECT_ENSURE_REGISTERED(PacketAckHeader);
+
+PacketAckHeader::PacketAckHeader()
+	: m_cumulativeAck(0) {}
+
+PacketAckHeader::PacketAckHeader(uint64_t cumulativeAck)
+	: m_cumulativeAck(cumulativeAck) {}
+
+PacketAckHeader::~PacketAckHeader() {}
+
+void PacketAckHeader::AddSackBlock(uint64_t start, uint64_t end) {
+	m_sackBlocks.push_back(std::make_pair(start, end));
+}
+
+void PacketAckHeader::ClearSackBlocks(void) {
+	m_sackBlocks.clear();
+}
+
+uint32_t PacketAckHeader::Deserialize(Buffer::Iterator start) {
+	m_cumulativeAck = start.ReadNtohU64();
+	m_sackBlocks.resize(start.ReadU8());
+
+	for (size_t i = 0; i < m_sackBlocks.size(); i++) {
+		m_sackBlocks[i].first = start.ReadNtohU64();
+		m_sackBlocks[i].second = start.ReadNtohU64();
+	}
+
+	return GetSerializedSize();
+}
+
+uint32_t PacketAckHeader::GetSerializedSize(void) const {
+	return 9 + 16 * m_sackBlocks.size();
+}
+
+void PacketAckHeader::Print(std::ostream &os) const {
+	os << "ack=" << m_cumulativeAck;
+
+	for (size_t i = 0; i < m_sackBlocks.size(); i++) {
+		os << " sack=" << m_sackBlocks[i].first << "-" << m_sackBlocks[i].second;
+	}
+}
+
+void PacketAckHeader::Serialize(Buffer::Iterator start) const {
+	start.WriteHtonU64(m_cumulativeAck);
+	start.WriteU8(m_sackBlocks.size());
+
+	for (size_t i = 0; i < m_sackBlocks.size(); i++) {
+		start.WriteHtonU64(m_sackBlocks[i].first);
+		start.WriteHtonU64(m_sackBlocks[i].second);
+	}
+}
+
+TypeId PacketAckHeader::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::PacketAckHeader")
+		.SetParent<Header>()
+		.SetGroupName("Headers")
+		.AddConstructor<PacketAckHeader>()
+		;
+
+	return tid;
+}
+
+TypeId PacketAckHeader::GetInstanceTypeId(void) const {
+	return GetTypeId();
+}
+
 } // namespace ns3
@@ -6,9 +6,202 @@
 #include "ns3/socket.h"
 #include "ns3/header.h"
 #include "ns3/simulator.h"
+#include "ns3/event-id.h"
+#include "ns3/address.h"
+#include "ns3/data-rate.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
+
+#include <vector>
 
 namespace ns3 {
 
+/**
+ * ACK sent back by the AckServerApplication. Acknowledges every sequence
+ * number below the cumulative ACK and optionally lists blocks of sequence
+ * numbers [start, end) received above it. Written in network byte order.
+ */
+class PacketAckHeader : public Header {
+public:
+	PacketAckHeader();
+	PacketAckHeader(uint64_t cumulativeAck);
+	virtual ~PacketAckHeader();
+	virtual uint32_t Deserialize(Buffer::Iterator start);
+	virtual uint32_t GetSerializedSize(void) const;
+	virtual void Print(std::ostream &os) const;
+	virtual void Serialize(Buffer::Iterator start) const;
+
+	virtual uint64_t GetCumulativeAck() {
+		return m_cumulativeAck;
+	}
+
+	virtual void SetCumulativeAck(uint64_t cumulativeAck) {
+		m_cumulativeAck = cumulativeAck;
+	}
+
+	void AddSackBlock(uint64_t start, uint64_t end);
+	void ClearSackBlocks(void);
+
+	virtual uint8_t GetSackBlockCount() {
+		return m_sackBlocks.size();
+	}
+
+	virtual uint64_t GetSackBlockStart(uint8_t i) {
+		return m_sackBlocks[i].first;
+	}
+
+	virtual uint64_t GetSackBlockEnd(uint8_t i) {
+		return m_sackBlocks[i].second;
+	}
+
+	static TypeId GetTypeId(void);
+	virtual TypeId GetInstanceTypeId(void) const;
+private:
+	uint64_t m_cumulativeAck;
+	std::vector<std::pair<uint64_t, uint64_t>> m_sackBlocks;
+};
+
+/**
+ * Received data rate, estimated over a sliding window of RATE_BUCKETS
+ * buckets and as an exponentially weighted moving average sampled once
+ * per bucket.
+ */
+class AckServerDataRate {
+public:
+	static const uint32_t RATE_BUCKETS = 8;
+
+	AckServerDataRate();
+
+	void Reset(double alpha, Time interval, Time now);
+	void Add(Time now, uint64_t bytes);
+	void Roll(Time now);
+
+	uint64_t GetMeanDataRate(void) const {
+		return m_meanDataRate;
+	}
+
+	uint64_t GetWindowDataRate(void) const {
+		return m_windowDataRate;
+	}
+
+	/**
+	 * Length of one bucket, the interval at which the estimates change without new data.
+	 */
+	Time GetBucketLength(void) const {
+		return m_interval / RATE_BUCKETS;
+	}
+
+private:
+	void UpdateWindowDataRate(Time now);
+
+	double		m_alpha;
+	Time		m_interval;
+	Time		m_startTime;
+	Time		m_bucketStart;
+	uint32_t	m_bucket;
+	uint64_t	m_buckets[RATE_BUCKETS];	//!< Bytes received per bucket of the sliding window
+	double		m_ewmaDataRate;
+	uint64_t	m_meanDataRate;
+	uint64_t	m_windowDataRate;
+};
+
+/**
+ * Sliding bitmap of the sequence numbers received above the next expected
+ * one. The bitmap is a ring of 64 bit words whose size is a power of two,
+ * it starts with one word and doubles up to the maximum size on demand.
+ */
+class AckServerReceiveWindow {
+public:
+	enum Result {
+		RECEIVED_NEW,		//!< First copy, nothing above it received yet
+		RECEIVED_REORDERED,	//!< First copy, arrived after a higher sequence number
+		RECEIVED_DUPLICATE,	//!< Received before
+		RECEIVED_BEYOND_WINDOW	//!< Too far above the next expected sequence number
+	};
+
+	AckServerReceiveWindow(uint32_t maxSize);
+
+	/**
+	 * Classifies and records seq. For reordered packets distance is set to the
+	 * number of sequence numbers between seq and the highest one received
+	 * (RFC 4737 reordering extent), otherwise to 0.
+	 */
+	Result Receive(uint64_t seq, uint64_t& distance);
+
+	/**
+	 * Moves the next expected sequence number up to seq, the sender will not
+	 * send anything below it again. Holes below seq are given up.
+	 */
+	void Advance(uint64_t seq);
+
+	uint64_t GetNextExpectedSeq(void) const {
+		return m_base;
+	}
+
+	/**
+	 * One above the highest received sequence number.
+	 */
+	uint64_t GetReceivedEnd(void) const {
+		return m_highest;
+	}
+
+	bool HasGap(void) const {
+		return m_highest > m_base;
+	}
+
+	/**
+	 * First sequence number at or above from that is (not) received, or one
+	 * above the highest received sequence number if there is none.
+	 */
+	uint64_t FindNext(uint64_t from, bool received) const;
+
+	/**
+	 * Range [start, end) of received sequence numbers containing seq.
+	 */
+	bool FindRange(uint64_t seq, uint64_t& start, uint64_t& end) const;
+
+private:
+	bool Test(uint64_t seq) const;
+	void Set(uint64_t seq);
+	void Clear(uint64_t seq);
+	bool Grow(uint64_t seq);
+	void SkipReceived(void);
+
+	std::vector<uint64_t> m_words;
+	uint64_t	m_mask;		//!< Number of bits minus one
+	uint64_t	m_base;		//!< Next expected sequence number, its bit is never set
+	uint64_t	m_highest;	//!< One above the highest received sequence number
+	uint64_t	m_topStart;	//!< Start of the range of received sequence numbers ending at m_highest, if above m_base
+	uint64_t	m_belowStart;	//!< Range [m_belowStart, m_belowEnd) of received sequence numbers below the top range, stale once m_base passes it
+	uint64_t	m_belowEnd;
+	uint32_t	m_maxSize;
+};
+
+/**
+ * State the AckServerApplication keeps for every peer. Byte counts and
+ * rates only include the first copy of every packet.
+ */
+class AckServerFlow {
+public:
+	static const uint32_t REORDER_BINS = 16;
+
+	AckServerFlow(const Address& peer, uint32_t maxReceiveWindow);
+
+	Address		m_peer;
+	Time		m_startTime;
+	uint64_t	m_packetsReceived;	//!< Packets accepted for the first time, without duplicates
+	uint64_t	m_bytesReceived;
+	uint64_t	m_duplicates;	//!< Packets received a second time
+	uint64_t	m_outOfOrder;	//!< Packets received after a higher sequence number
+	uint64_t	m_reorderHistogram[REORDER_BINS];	//!< Bin i counts reordering distances in [2^i, 2^(i+1)), the last bin everything above
+	AckServerDataRate m_dataRate;
+
+	AckServerReceiveWindow m_receiveWindow;
+	uint64_t	m_lastSackSeq;
+	uint32_t	m_pendingAcks;
+	EventId		m_delayedAckEvent;
+};
+
 class AckServerApplication : public Application {
 public:
 	static TypeId GetTypeId(void);
@@ -19,7 +212,16 @@ public:
 	Time GetStartTime(void);
 	uint64_t GetTotalPacketsReceived(void);
 	uint64_t GetTotalBytesReceived(void);
+	uint64_t GetTotalDuplicatesReceived(void);
+	uint64_t GetTotalOutOfOrderReceived(void);
+	uint64_t GetReorderHistogram(uint32_t bin);
 	uint64_t GetMeanDataRate(void);
+	uint64_t GetWindowDataRate(void);
+	uint64_t GetTotalAcksSent(void);
+
+	uint32_t GetFlowCount(void);
+	const AckServerFlow& GetFlow(uint32_t i);
+	const AckServerFlow* FindFlow(const Address& peer);
 
 	void Reset(void);
 	void ResetStartTime(void);
@@ -27,28 +229,69 @@ public:
 	void ResetTotalBytesReceived(void);
 	void ResetDataRate(void);
 private:
+	static const uint32_t NO_FLOW = 0xffffffff;
+
 	virtual void StartApplication(void);
 	virtual void StopApplication(void);
 
 	void HandleRead(Ptr<Socket> socket);
+	void CountReorder(AckServerFlow& flow, uint64_t distance);
+	void SendAck(uint32_t flow);
 	uint64_t CalcMeanDataRate(Ptr<Packet> currentPacket);
+	void RollDataRate(void);
+	void UpdateDataRateTraces(void);
+
+	static uint32_t HashAddress(const Address& address);
+	uint32_t FindFlowIndex(const Address& peer, uint32_t& slot);
+	uint32_t GetFlowIndex(const Address& peer);
+	void GrowFlowTable(void);
 
 	Ptr<Socket>     m_socket;
+	uint16_t	m_port;
 	Time		m_startTime;
 	uint64_t        m_totalPacketsReceived;
 	uint64_t	m_totalBytesReceived;
+	uint64_t	m_totalDuplicates;
+	uint64_t	m_totalOutOfOrder;
+	uint64_t	m_reorderHistogram[AckServerFlow::REORDER_BINS];
 
-	Time		m_lastPacketTime;
-	uint64_t	m_meanDataRate;
-	uint64_t	m_dataRate0;
-	uint64_t	m_dataRate1;
-	uint64_t	m_dataRate2;
+	double		m_rateAlpha;
+	Time		m_rateInterval;
+	AckServerDataRate m_dataRate;	//!< Aggregate over all flows
+	TracedValue<DataRate> m_meanDataRateTrace;
+	TracedValue<DataRate> m_windowDataRateTrace;
+	EventId		m_rollEvent;	//!< Lets the traces fall once the data stops
+	TracedCallback<Ptr<const Packet>, const Address&> m_rxTrace;
+
+	uint32_t	m_ackEvery;
+	Time		m_ackDelay;
+	uint32_t	m_maxSackBlocks;
+	uint32_t	m_maxReceiveWindow;
+
+	// open addressing hash table, the slots index the densely stored flows
+	uint32_t	m_expectedPeers;
+	std::vector<AckServerFlow> m_flows;
+	std::vector<uint32_t> m_flowSlots;
+	uint32_t	m_flowMask;
+
+	PacketAckHeader	m_ackHeader;	//!< Reused for every ACK, keeps the capacity of its SACK block list
+	Ptr<Packet>	m_ackTemplate;	//!< Empty packet every ACK is a copy of
+	uint64_t	m_totalAcksSent;
 };
 
+/**
+ * Sequence number the SlidingClient assigns to each data packet. Numbers
+ * are consecutive per client and start at 0, so both ends agree on them
+ * without sharing simulator state. The window head is the oldest sequence
+ * number the client still waits for, it will not send anything below it
+ * again. Written in network byte order.
+ */
 class PacketSeqHeader : public Header {
 public:
-	PacketSeqHeader() {}
-	PacketSeqHeader(uint64_t seq);
+	PacketSeqHeader()
+		: m_seq(0)
+		, m_windowHead(0) {}
+	PacketSeqHeader(uint64_t seq, uint64_t windowHead);
 	virtual ~PacketSeqHeader();
 	virtual uint32_t Deserialize(Buffer::Iterator start);
 	virtual uint32_t GetSerializedSize(void) const;
@@ -63,10 +306,19 @@ public:
 		m_seq = seq;
 	}
 
+	virtual uint64_t GetWindowHead() {
+		return m_windowHead;
+	}
+
+	virtual void SetWindowHead(uint64_t windowHead) {
+		m_windowHead = windowHead;
+	}
+
 	static TypeId GetTypeId(void);
 	virtual TypeId GetInstanceTypeId(void) const;
 private:
 	uint64_t m_seq;
+	uint64_t m_windowHead;
 };
 
 } // namespace ns3
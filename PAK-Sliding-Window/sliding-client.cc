@@ -9,6 +9,10 @@
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/type-id.h"
+#include "ns3/object-factory.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/udp-socket-factory.h"
 
@@ -18,20 +22,143 @@
 
 namespace ns3 {
 
-SlidingClientPacketRecord::SlidingClientPacketRecord(Ptr<Packet> packet, uint64_t sentBytes, Time timeoutTime, SlidingClient* sClient)
-	: m_packet(packet)
-	, m_sentBytes(sentBytes)
-	, m_sClient(sClient) {
-	m_eventId = Simulator::Schedule(timeoutTime, &SlidingClientPacketRecord::Timeout, this);
-}
+SlidingClientPacketRecord::SlidingClientPacketRecord()
+	: m_packet(0)
+	, m_seq(0)
+	, m_sentBytes(0)
+	, m_sClient(0)
+	, m_releasedEnd(0)
+	, m_retransmitted(false)
+	, m_lost(false)
+	, m_inUse(false) {}
 
 void SlidingClientPacketRecord::Timeout() {
-	if (m_sClient->m_unackedPackets.count(m_packet->GetUid()) != 0) {
+	if (!m_inUse || m_lost) {
+		return;
+	}
+
+	m_sClient->EnterLoss(m_sentTime);
+
+	switch (m_sClient->m_retransmitMode) {
+	case SlidingClient::RETRANSMIT_NONE:
 		m_sClient->m_windowFillLevel -= m_sentBytes;
-		m_sClient->m_unackedPackets.erase(m_packet->GetUid());
+		m_sClient->m_unackedPackets.Release(m_seq);
+
+		m_sClient->ScheduleNextPacket(m_sClient->m_packetSize);
+		break;
+	case SlidingClient::RETRANSMIT_GO_BACK_N:
+		for (uint64_t seq = m_seq; seq < m_sClient->m_unackedPackets.GetTail(); seq = m_sClient->m_unackedPackets.NextInUse(seq + 1)) {
+			m_sClient->MarkLost(seq);
+		}
 
 		m_sClient->ScheduleNextPacket(m_sClient->m_packetSize);
+		break;
+	case SlidingClient::RETRANSMIT_SELECTIVE_REPEAT:
+		m_sClient->MarkLost(m_seq);
+		m_sClient->ScheduleNextPacket(m_sClient->m_packetSize);
+		break;
+	}
+}
+
+
+SlidingClientWindow::SlidingClientWindow()
+	: m_slots(1)
+	, m_mask(0)
+	, m_head(0)
+	, m_tail(0)
+	, m_count(0) {}
+
+void SlidingClientWindow::Reserve(uint64_t capacity) {
+	while (m_slots.size() < capacity) {
+		Grow();
+	}
+}
+
+SlidingClientPacketRecord* SlidingClientWindow::Push(Ptr<Packet> packet, uint64_t sentBytes, SlidingClient* sClient) {
+	if (m_tail - m_head == m_slots.size()) {
+		Grow();
+	}
+
+	SlidingClientPacketRecord& rec = Slot(m_tail);
+	rec.m_packet = packet;
+	rec.m_seq = m_tail;
+	rec.m_sentBytes = sentBytes;
+	rec.m_sClient = sClient;
+	rec.m_sentTime = Simulator::Now();
+	rec.m_retransmitted = false;
+	rec.m_lost = false;
+	rec.m_inUse = true;
+
+	m_tail++;
+	m_count++;
+
+	return &rec;
+}
+
+SlidingClientPacketRecord* SlidingClientWindow::Get(uint64_t seq) {
+	if (seq < m_head || seq >= m_tail || !Slot(seq).m_inUse) {
+		return 0;
+	}
+
+	return &Slot(seq);
+}
+
+SlidingClientPacketRecord* SlidingClientWindow::OldestInFlight() {
+	// lost records are resent first, so only a few of them lie ahead of the first one in flight
+	for (uint64_t seq = NextInUse(m_head); seq < m_tail; seq = NextInUse(seq + 1)) {
+		if (!Slot(seq).m_lost) {
+			return &Slot(seq);
+		}
+	}
+
+	return 0;
+}
+
+void SlidingClientWindow::Release(uint64_t seq) {
+	SlidingClientPacketRecord* rec = Get(seq);
+
+	if (rec == 0) {
+		return;
+	}
+
+	rec->m_packet = 0;
+	rec->m_releasedEnd = seq + 1;
+	rec->m_inUse = false;
+	m_count--;
+
+	while (m_head < m_tail && !Slot(m_head).m_inUse) {
+		m_head++;
+	}
+}
+
+uint64_t SlidingClientWindow::NextInUse(uint64_t seq) {
+	seq = std::max(seq, m_head);
+
+	// released records between head and tail stay released, so the links only ever point forward
+	while (seq < m_tail && !Slot(seq).m_inUse) {
+		SlidingClientPacketRecord& rec = Slot(seq);
+
+		// path halving keeps the chains short
+		if (rec.m_releasedEnd < m_tail && !Slot(rec.m_releasedEnd).m_inUse) {
+			rec.m_releasedEnd = Slot(rec.m_releasedEnd).m_releasedEnd;
+		}
+
+		seq = rec.m_releasedEnd;
+	}
+
+	return std::min(seq, m_tail);
+}
+
+void SlidingClientWindow::Grow() {
+	std::vector<SlidingClientPacketRecord> slots(m_slots.size() * 2);
+	uint64_t mask = slots.size() - 1;
+
+	for (uint64_t seq = m_head; seq < m_tail; seq++) {
+		slots[seq & mask] = Slot(seq);
 	}
+
+	m_slots.swap(slots);
+	m_mask = mask;
 }
 
 
@@ -59,9 +186,75 @@ TypeId SlidingClient::GetTypeId(void) {
 			DataRateValue(DataRate("500Kbps")),
 			MakeDataRateAccessor(&SlidingClient::m_dataRate),
 			MakeDataRateChecker())
+		.AddAttribute("PacingBurst", "Depth of the pacing token bucket in byte, at most one packet if smaller than PacketSize.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&SlidingClient::m_pacingBurst),
+			MakeUintegerChecker<uint64_t>())
+		.AddAttribute("BurstMode", "Send as many packets as the window allows once the pacer lets the first one go.",
+			BooleanValue(false),
+			MakeBooleanAccessor(&SlidingClient::m_burstMode),
+			MakeBooleanChecker())
+		.AddAttribute("MaxBurst", "Maximum number of packets per burst in burst mode, 0 for no limit.",
+			UintegerValue(0),
+			MakeUintegerAccessor(&SlidingClient::m_maxBurst),
+			MakeUintegerChecker<uint32_t>())
+		.AddAttribute("RetransmitMode", "What to do with packets whose retransmission timeout expired.",
+			EnumValue(SlidingClient::RETRANSMIT_NONE),
+			MakeEnumAccessor(&SlidingClient::m_retransmitMode),
+			MakeEnumChecker(SlidingClient::RETRANSMIT_NONE, "None",
+				SlidingClient::RETRANSMIT_GO_BACK_N, "GoBackN",
+				SlidingClient::RETRANSMIT_SELECTIVE_REPEAT, "SelectiveRepeat"))
+		.AddAttribute("CongestionControl", "Type of the congestion control algorithm limiting the window.",
+			TypeIdValue(SlidingCongestionNone::GetTypeId()),
+			MakeTypeIdAccessor(&SlidingClient::m_congestionTypeId),
+			MakeTypeIdChecker())
+		.AddAttribute("TimerMode", "Whether each unacked packet gets its own timeout event or one timer per client tracks the oldest unacked packet.",
+			EnumValue(SlidingClient::PER_PACKET_TIMER),
+			MakeEnumAccessor(&SlidingClient::m_timerMode),
+			MakeEnumChecker(SlidingClient::PER_PACKET_TIMER, "PerPacket",
+				SlidingClient::SINGLE_TIMER, "Single"))
+		.AddAttribute("InitialRto", "Retransmission timeout used until the first RTT sample is taken.",
+			TimeValue(MilliSeconds(500)),
+			MakeTimeAccessor(&SlidingClient::m_initialRto),
+			MakeTimeChecker())
+		.AddAttribute("MinRto", "Lower bound of the retransmission timeout.",
+			TimeValue(MilliSeconds(10)),
+			MakeTimeAccessor(&SlidingClient::m_minRto),
+			MakeTimeChecker())
+		.AddAttribute("MaxRto", "Upper bound of the retransmission timeout, also limits the exponential backoff.",
+			TimeValue(Seconds(60)),
+			MakeTimeAccessor(&SlidingClient::m_maxRto),
+			MakeTimeChecker())
 		.AddTraceSource("Tx", "A new packet is created and is sent",
 			MakeTraceSourceAccessor(&SlidingClient::m_txTrace),
 			"ns3::Packet::TracedCallback")
+		.AddTraceSource("Retransmit", "A packet is sent again after its retransmission timeout expired",
+			MakeTraceSourceAccessor(&SlidingClient::m_retransmitTrace),
+			"ns3::Packet::TracedCallback")
+		.AddTraceSource("Burst", "Number of packets sent back to back by one send event",
+			MakeTraceSourceAccessor(&SlidingClient::m_burstTrace),
+			"ns3::SlidingClient::BurstTracedCallback")
+		.AddTraceSource("CongestionWindow", "Congestion window in byte",
+			MakeTraceSourceAccessor(&SlidingClient::m_cWnd),
+			"ns3::TracedValueCallback::Uint64")
+		.AddTraceSource("SlowStartThreshold", "Slow start threshold in byte, at most WindowSize",
+			MakeTraceSourceAccessor(&SlidingClient::m_ssThresh),
+			"ns3::TracedValueCallback::Uint64")
+		.AddTraceSource("CongestionPhase", "Slow start, congestion avoidance or recovery",
+			MakeTraceSourceAccessor(&SlidingClient::m_phase),
+			"ns3::SlidingCongestionState::PhaseTracedCallback")
+		.AddTraceSource("CongestionEvent", "A loss reduced the congestion window, with the bytes in flight at that time",
+			MakeTraceSourceAccessor(&SlidingClient::m_congestionTrace),
+			"ns3::SlidingClient::CongestionTracedCallback")
+		.AddTraceSource("RTT", "Last RTT sample",
+			MakeTraceSourceAccessor(&SlidingClient::m_lastRtt),
+			"ns3::TracedValueCallback::Time")
+		.AddTraceSource("RttSample", "Every RTT sample, also when it equals the last one",
+			MakeTraceSourceAccessor(&SlidingClient::m_rttSampleTrace),
+			"ns3::SlidingClient::RttSampleTracedCallback")
+		.AddTraceSource("RTO", "Retransmission timeout",
+			MakeTraceSourceAccessor(&SlidingClient::m_rto),
+			"ns3::TracedValueCallback::Time")
 		;
 
 	return tid;
@@ -75,8 +268,23 @@ SlidingClient::SlidingClient()
 	, m_remaining(0)
 	, m_windowFillLevel(0)
 	, m_nextSendSize(1400)
+	, m_pacingBurst(0)
+	, m_burstMode(false)
+	, m_maxBurst(0)
+	, m_running(false)
+	, m_timerMode(PER_PACKET_TIMER)
+	, m_retransmitMode(RETRANSMIT_NONE)
+	, m_initialRto(MilliSeconds(500))
+	, m_minRto(MilliSeconds(10))
+	, m_maxRto(Seconds(60))
+	, m_rttValid(false)
+	, m_recovering(false)
+	, m_recoverySeq(0)
 	, m_sentPackets(0)
-	, m_ackedPackets(0) {
+	, m_ackedPackets(0)
+	, m_retransmittedPackets(0)
+	, m_timerEvents(0)
+	, m_sendEvents(0) {
 	NS_LOG_FUNCTION(this);
 }
 
@@ -103,6 +311,8 @@ void SlidingClient::DoDispose(void) {
 	NS_LOG_FUNCTION(this);
 
 	m_socket = 0;
+	m_payload = 0;
+	m_congestionOps = 0;
 	Application::DoDispose();
 }
 
@@ -119,12 +329,47 @@ void SlidingClient::StartApplication(void) {
 	// m_socket->SetSendCallback(MakeCallback(&SlidingClient::BufferAvailableCb, this));
 	m_socket->SetRecvCallback(MakeCallback(&SlidingClient::AckAvailableCb, this));
 
+	m_payload = Create<Packet>(m_packetSize);
+
+	// one slot per full packet the window can hold, partial packets make the buffer grow
+	m_unackedPackets.Reserve((m_windowSize + m_packetSize - 1) / std::max<uint64_t>(m_packetSize, 1));
+
+	m_rttValid = false;
+	m_rto = m_initialRto;
+
+	ObjectFactory congestionFactory;
+	congestionFactory.SetTypeId(m_congestionTypeId);
+	m_congestionOps = congestionFactory.Create<SlidingCongestionOps>();
+	m_congestionState.m_segmentSize = m_packetSize;
+	m_congestionOps->Init(m_congestionState);
+	m_recovering = false;
+	UpdateCongestionState();
+
+	uint64_t burstBits = (std::max(m_pacingBurst, m_packetSize) - m_packetSize) * 8;
+	m_pacingTolerance = Seconds(burstBits / static_cast<double>(m_dataRate.GetBitRate()));
+	m_pacingTime = Simulator::Now();
+
+	m_running = true;
 	ScheduleNextPacket(m_packetSize);
 }
 
 void SlidingClient::StopApplication(void) {
 	NS_LOG_FUNCTION(this);
 
+	m_running = false;
+	Simulator::Cancel(m_sendEventId);
+	Simulator::Cancel(m_retransmitEventId);
+	m_lostPackets.clear();
+
+	// pending timeouts would back off and send on the closed socket
+	for (uint64_t seq = m_unackedPackets.GetHead(); seq < m_unackedPackets.GetTail(); seq++) {
+		SlidingClientPacketRecord* pRec = m_unackedPackets.Get(seq);
+
+		if (pRec != 0) {
+			Simulator::Cancel(pRec->m_eventId);
+		}
+	}
+
 	if (m_socket != 0) {
 		m_socket->Close();
 	}
@@ -137,50 +382,114 @@ void SlidingClient::StopApplication(void) {
 void SlidingClient::ScheduleNextPacket(uint64_t sendSize) {
 	NS_LOG_FUNCTION(this);
 
-	Simulator::Cancel(m_sendEventId);
+	m_nextSendSize = sendSize;
 
-	uint64_t bits = m_packetSize * 8;
-	Time nextTime(Seconds(bits / static_cast<double>(m_dataRate.GetBitRate())));
+	// a pending send event picks up whatever the window allows once it runs,
+	// with a closed window the next ACK or timeout schedules the send
+	if (!m_running || m_sendEventId.IsRunning() || m_windowFillLevel >= GetEffectiveWindow()) {
+		return;
+	}
 
-	m_nextSendSize = sendSize;
+	Time nextTime = Max(m_pacingTime - m_pacingTolerance - Simulator::Now(), Seconds(0));
+
+	m_sendEvents++;
 	m_sendEventId = Simulator::Schedule(nextTime, &SlidingClient::SendPacket, this);
 }
 
 void SlidingClient::SendPacket() {
 	NS_LOG_FUNCTION(this);
 
-	uint64_t availableWindowSize = m_windowSize - m_windowFillLevel;
-	uint64_t toSend = std::min(m_nextSendSize, availableWindowSize);
+	uint32_t burst = 0;
+
+	// token bucket in its virtual clock form: m_pacingTime is the time the
+	// bucket would be empty, up to m_pacingTolerance of it may be sent early
+	while (m_windowFillLevel < GetEffectiveWindow()) {
+		if (m_burstMode && burst > 0) {
+			// only the first packet of a burst waits for the pacer
+			if (m_maxBurst != 0 && burst >= m_maxBurst) {
+				break;
+			}
+		}
+		else if (Simulator::Now() < m_pacingTime - m_pacingTolerance) {
+			break;
+		}
+
+		// lost packets go first, through the same window and pacer as new data
+		if (!m_lostPackets.empty()) {
+			uint64_t seq = m_lostPackets.front();
+			m_lostPackets.pop_front();
 
-	// TODO: maybe set a better min bytes send threshold
-	if (toSend > 0) {
-		Ptr<Packet> packet = Create<Packet>(toSend);
-		m_txTrace(packet);
-		uint64_t actual = (uint64_t) m_socket->SendTo(packet, 0, m_peer);
+			if (Retransmit(seq)) {
+				burst++;
+			}
 
-		m_windowFillLevel += actual;
-		m_sentPackets++;
+			continue;
+		}
 
-		Ptr<SlidingClientPacketRecord> pRec = Create<SlidingClientPacketRecord>(packet, actual, MilliSeconds(500), this); // TODO: dynamic packet timeout
-		m_unackedPackets[packet->GetUid()] = pRec;
+		// TODO: maybe set a better min bytes send threshold
+		uint64_t availableWindowSize = GetEffectiveWindow() - m_windowFillLevel;
+		uint64_t toSend = std::min(m_nextSendSize, availableWindowSize);
+		uint64_t actual = SendSinglePacket(toSend);
+
+		uint64_t bits = toSend * 8;
+		m_pacingTime = Max(m_pacingTime, Simulator::Now()) + Seconds(bits / static_cast<double>(m_dataRate.GetBitRate()));
+		burst++;
 
 		if (actual != toSend) {
 			m_remaining = toSend - actual;
-			ScheduleNextPacket(m_remaining);
+			m_nextSendSize = m_remaining;
+
+			// the socket refused the packet, retry once the pacer allows it
+			break;
 		}
 		else {
 			m_remaining = 0;
-			ScheduleNextPacket(m_packetSize);
+			m_nextSendSize = m_packetSize;
 		}
 	}
-	else {
-		if (m_remaining != 0) {
-			ScheduleNextPacket(m_remaining);
-		}
-		else {
-			ScheduleNextPacket(m_packetSize);
-		}
+
+	if (burst > 0) {
+		m_burstTrace(burst);
 	}
+
+	ScheduleNextPacket(m_nextSendSize);
+}
+
+uint64_t SlidingClient::SendSinglePacket(uint64_t toSend) {
+	NS_LOG_FUNCTION(this << toSend);
+
+	PacketSeqHeader sHeader(m_unackedPackets.GetTail(), m_unackedPackets.GetHead());
+
+	// a fragment shares the payload's buffer instead of creating one per packet
+	Ptr<Packet> packet = m_payload->CreateFragment(0, toSend);
+	packet->AddHeader(sHeader);
+	int sent = m_socket->SendTo(packet, 0, m_peer);
+
+	// only payload bytes count towards the window
+	uint64_t actual = (sent > (int) sHeader.GetSerializedSize()) ? sent - sHeader.GetSerializedSize() : 0;
+
+	// a refused packet keeps its sequence number for the retry, a record of it would only time out
+	if (actual == 0) {
+		return 0;
+	}
+
+	m_txTrace(packet);
+	m_windowFillLevel += actual;
+	m_sentPackets++;
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.Push(packet, actual, this);
+	pRec->m_timeoutTime = Simulator::Now() + m_rto.Get();
+
+	if (m_timerMode == PER_PACKET_TIMER) {
+		m_timerEvents++;
+		pRec->m_eventId = Simulator::Schedule(m_rto.Get(), &SlidingClient::PacketTimeout, this, pRec->m_seq);
+	}
+	else if (!m_retransmitEventId.IsRunning()) {
+		// otherwise the timer already runs for an older packet
+		ArmRetransmitTimer();
+	}
+
+	return actual;
 }
 
 void SlidingClient::BufferAvailableCb(Ptr<Socket>, uint32_t) {
@@ -200,20 +509,250 @@ void SlidingClient::AckAvailableCb(Ptr<Socket> socket) {
 	Ptr<Packet> packet;
 	Address from;
 
-	while (packet = socket->RecvFrom(from)) {
-		PacketSeqHeader pHeader;
-		packet->PeekHeader(pHeader);
+	while ((packet = socket->RecvFrom(from))) {
+		PacketAckHeader& aHeader = m_ackHeader;
+		aHeader.ClearSackBlocks();
 
-		if (m_unackedPackets.count(pHeader.GetSeq()) != 0) {
-			m_ackedPackets++;
-			Simulator::Cancel(m_unackedPackets[pHeader.GetSeq()]->m_eventId);
+		if (from != m_peer || packet->GetSize() < aHeader.GetSerializedSize()) {
+			NS_LOG_WARN("SlidingClient ignored invalid ACK from " << from);
+			continue;
+		}
+
+		// the SACK block count follows the cumulative ack, the blocks it announces must all be there
+		uint8_t fixedPart[9];
+		packet->CopyData(fixedPart, sizeof(fixedPart));
+
+		if (packet->GetSize() < sizeof(fixedPart) + 16 * fixedPart[8]) {
+			NS_LOG_WARN("SlidingClient ignored truncated ACK from " << from);
+			continue;
+		}
+
+		packet->RemoveHeader(aHeader);
+
+		Time sampleSentTime;
+		bool hasSample = false;
+		uint64_t acked = AckRange(0, aHeader.GetCumulativeAck(), sampleSentTime, hasSample);
+
+		for (uint8_t i = 0; i < aHeader.GetSackBlockCount(); i++) {
+			acked += AckRange(aHeader.GetSackBlockStart(i), aHeader.GetSackBlockEnd(i), sampleSentTime, hasSample);
+		}
+
+		// Karn's rule: the ACK of a retransmitted packet is ambiguous
+		if (hasSample) {
+			UpdateRtt(Simulator::Now() - sampleSentTime);
+		}
+
+		if (acked > 0 && m_timerMode == SINGLE_TIMER) {
+			// the oldest packet in flight may have changed, and with it the deadline
+			ArmRetransmitTimer();
+		}
 
-			m_windowFillLevel -= m_unackedPackets[pHeader.GetSeq()]->m_sentBytes;
-			m_unackedPackets.erase(pHeader.GetSeq());
+		if (acked > 0) {
+			if (m_recovering && m_unackedPackets.GetHead() >= m_recoverySeq) {
+				m_recovering = false;
+			}
+
+			m_congestionState.m_bytesInFlight = m_windowFillLevel;
+			m_congestionOps->IncreaseWindow(m_congestionState, acked);
+			UpdateCongestionState();
 
 			ScheduleNextPacket(m_packetSize);
 		}
 	}
 }
 
+uint64_t SlidingClient::AckRange(uint64_t start, uint64_t end, Time& sampleSentTime, bool& hasSample) {
+	NS_LOG_FUNCTION(this << start << end);
+
+	uint64_t acked = 0;
+	uint64_t ackedPackets = 0;
+
+	end = std::min(end, m_unackedPackets.GetTail());
+
+	// records SACKed by an earlier ACK are skipped, so each one is only processed once
+	for (uint64_t seq = m_unackedPackets.NextInUse(start); seq < end; seq = m_unackedPackets.NextInUse(seq + 1)) {
+		SlidingClientPacketRecord* pRec = m_unackedPackets.Get(seq);
+
+		if (!pRec->m_retransmitted && (!hasSample || pRec->m_sentTime > sampleSentTime)) {
+			sampleSentTime = pRec->m_sentTime;
+			hasSample = true;
+		}
+
+		if (m_timerMode == PER_PACKET_TIMER) {
+			Simulator::Cancel(pRec->m_eventId);
+		}
+
+		// a lost record's bytes already left the window
+		if (!pRec->m_lost) {
+			m_windowFillLevel -= pRec->m_sentBytes;
+		}
+
+		acked += pRec->m_sentBytes;
+		ackedPackets++;
+
+		m_unackedPackets.Release(seq);
+	}
+
+	m_ackedPackets += ackedPackets;
+
+	return acked;
+}
+
+void SlidingClient::PacketTimeout(uint64_t seq) {
+	NS_LOG_FUNCTION(this << seq);
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.Get(seq);
+
+	if (pRec != 0) {
+		pRec->Timeout();
+	}
+}
+
+void SlidingClient::ArmRetransmitTimer(void) {
+	NS_LOG_FUNCTION(this);
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.OldestInFlight();
+
+	if (pRec == 0) {
+		Simulator::Cancel(m_retransmitEventId);
+		return;
+	}
+
+	// like TCP's single RTO timer it only guards the oldest packet in flight, with the current RTO
+	pRec->m_timeoutTime = pRec->m_sentTime + m_rto.Get();
+	Time delay = Max(pRec->m_timeoutTime - Simulator::Now(), Seconds(0));
+
+	if (m_retransmitEventId.IsRunning()) {
+		if (Simulator::GetDelayLeft(m_retransmitEventId) == delay) {
+			return;
+		}
+
+		Simulator::Cancel(m_retransmitEventId);
+	}
+
+	m_timerEvents++;
+	m_retransmitEventId = Simulator::Schedule(delay, &SlidingClient::RetransmitTimeout, this);
+}
+
+void SlidingClient::RetransmitTimeout() {
+	NS_LOG_FUNCTION(this);
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.OldestInFlight();
+
+	// only the oldest packet is timed, the next one is once this one is acked or has timed out
+	if (pRec != 0 && pRec->m_timeoutTime <= Simulator::Now()) {
+		pRec->Timeout();
+	}
+
+	ArmRetransmitTimer();
+}
+
+void SlidingClient::MarkLost(uint64_t seq) {
+	NS_LOG_FUNCTION(this << seq);
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.Get(seq);
+
+	if (pRec == 0 || pRec->m_lost) {
+		return;
+	}
+
+	// like TCP after an RTO the packet no longer counts as in flight
+	pRec->m_lost = true;
+	m_windowFillLevel -= pRec->m_sentBytes;
+	m_lostPackets.push_back(seq);
+
+	if (m_timerMode == PER_PACKET_TIMER) {
+		Simulator::Cancel(pRec->m_eventId);
+	}
+}
+
+bool SlidingClient::Retransmit(uint64_t seq) {
+	NS_LOG_FUNCTION(this << seq);
+
+	SlidingClientPacketRecord* pRec = m_unackedPackets.Get(seq);
+
+	// an ACK may have arrived for the original in the meantime
+	if (pRec == 0 || !pRec->m_lost || !m_running) {
+		return false;
+	}
+
+	Ptr<Packet> packet = pRec->m_packet->Copy();
+	m_retransmitTrace(packet);
+	m_socket->SendTo(packet, 0, m_peer);
+	m_retransmittedPackets++;
+
+	uint64_t bits = packet->GetSize() * 8;
+	m_pacingTime = Max(m_pacingTime, Simulator::Now()) + Seconds(bits / static_cast<double>(m_dataRate.GetBitRate()));
+
+	m_windowFillLevel += pRec->m_sentBytes;
+
+	pRec->m_lost = false;
+	pRec->m_retransmitted = true;
+	pRec->m_sentTime = Simulator::Now();
+	pRec->m_timeoutTime = Simulator::Now() + m_rto.Get();
+
+	if (m_timerMode == PER_PACKET_TIMER) {
+		m_timerEvents++;
+		pRec->m_eventId = Simulator::Schedule(m_rto.Get(), &SlidingClient::PacketTimeout, this, seq);
+	}
+	else if (!m_retransmitEventId.IsRunning()) {
+		ArmRetransmitTimer();
+	}
+
+	return true;
+}
+
+void SlidingClient::UpdateRtt(Time rtt) {
+	NS_LOG_FUNCTION(this << rtt);
+
+	// RFC 6298 with alpha = 1/8 and beta = 1/4
+	if (!m_rttValid) {
+		m_srtt = rtt;
+		m_rttVar = rtt / 2;
+		m_rttValid = true;
+	}
+	else {
+		m_rttVar = (m_rttVar * 3 + Abs(m_srtt - rtt)) / 4;
+		m_srtt = (m_srtt * 7 + rtt) / 8;
+	}
+
+	m_lastRtt = rtt;
+	m_rttSampleTrace(rtt);
+	m_congestionState.m_lastRtt = rtt;
+	m_congestionState.m_minRtt = (m_congestionState.m_minRtt.IsZero()) ? rtt : Min(m_congestionState.m_minRtt, rtt);
+	m_rto = Min(Max(m_srtt + m_rttVar * 4, m_minRto), m_maxRto);
+}
+
+void SlidingClient::EnterLoss(Time sentTime) {
+	NS_LOG_FUNCTION(this << sentTime);
+
+	// packets sent before the last backoff already timed out with the old RTO
+	if (sentTime < m_lastBackoffTime) {
+		return;
+	}
+
+	m_lastBackoffTime = Simulator::Now();
+	m_rto = Min(m_rto.Get() * 2, m_maxRto);
+
+	m_congestionState.m_bytesInFlight = m_windowFillLevel;
+	m_congestionTrace(m_windowFillLevel);
+	m_congestionOps->ReduceWindow(m_congestionState);
+
+	m_recovering = true;
+	m_recoverySeq = m_unackedPackets.GetTail();
+	UpdateCongestionState();
+}
+
+void SlidingClient::UpdateCongestionState() {
+	// growing the congestion window beyond the static window has no effect
+	m_congestionState.m_cWnd = std::min(m_congestionState.m_cWnd, m_windowSize);
+
+	m_cWnd = m_congestionState.m_cWnd;
+
+	// "no threshold yet" is the largest uint64_t, which would swamp every plot of the trace
+	m_ssThresh = std::min(m_congestionState.m_ssThresh, m_windowSize);
+
+	m_phase = m_recovering ? SlidingCongestionState::RECOVERY : m_congestionOps->GetPhase(m_congestionState);
+}
+
 } // namespace ns3
@@ -9,8 +9,14 @@
 #include "ns3/ptr.h"
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
+#include "ns3/traced-value.h"
 
-#include <map>
+#include "sliding-congestion-ops.h"
+#include "ack-server.h"
+
+#include <algorithm>
+#include <deque>
+#include <vector>
 
 namespace ns3 {
 
@@ -18,23 +24,103 @@ class Address;
 class Socket;
 class SlidingClient;
 
-class SlidingClientPacketRecord : public SimpleRefCount<SlidingClientPacketRecord> {
+class SlidingClientPacketRecord {
 	friend class SlidingClient;
+	friend class SlidingClientWindow;
 public:
-	SlidingClientPacketRecord(Ptr<Packet> packet, uint64_t sentBytes, Time timeoutTime, SlidingClient* sClient);
+	SlidingClientPacketRecord();
 
 	void Timeout();
 
 private:
 	Ptr<Packet>	m_packet;
+	uint64_t	m_seq;
 	uint64_t	m_sentBytes;
 	SlidingClient*	m_sClient;
 	EventId		m_eventId;
+	Time		m_sentTime;
+	Time		m_timeoutTime;
+	uint64_t	m_releasedEnd;	//!< Released records only: every record below this one is released too
+	bool		m_retransmitted;
+	bool		m_lost;		//!< Timed out and waiting to be resent, not counted as in flight
+	bool		m_inUse;
+};
+
+/**
+ * Ring buffer of unacknowledged packet records, indexed by the sequence
+ * number sent in the PacketSeqHeader of each packet. Slots are preallocated, so storing and releasing a record
+ * does not touch the heap. The buffer only grows if more records are in
+ * flight than the initial capacity allows for.
+ */
+class SlidingClientWindow {
+public:
+	SlidingClientWindow();
+
+	void Reserve(uint64_t capacity);
+
+	SlidingClientPacketRecord* Push(Ptr<Packet> packet, uint64_t sentBytes, SlidingClient* sClient);
+	SlidingClientPacketRecord* Get(uint64_t seq);
+	/**
+	 * Oldest record still in flight, lost records waiting to be resent are skipped.
+	 */
+	SlidingClientPacketRecord* OldestInFlight();
+	void Release(uint64_t seq);
+
+	/**
+	 * First sequence number at or above seq whose record is not released,
+	 * the tail if there is none. Runs of released records are skipped in
+	 * amortised constant time.
+	 */
+	uint64_t NextInUse(uint64_t seq);
+
+	inline uint64_t GetCount() const {
+		return m_count;
+	}
+
+	inline uint64_t GetCapacity() const {
+		return m_slots.size();
+	}
+
+	inline uint64_t GetHead() const {
+		return m_head;
+	}
+
+	inline uint64_t GetTail() const {
+		return m_tail;
+	}
+
+private:
+	inline SlidingClientPacketRecord& Slot(uint64_t seq) {
+		return m_slots[seq & m_mask];
+	}
+
+	void Grow();
+
+	std::vector<SlidingClientPacketRecord> m_slots;
+	uint64_t	m_mask;
+	uint64_t	m_head;
+	uint64_t	m_tail;
+	uint64_t	m_count;
 };
 
 class SlidingClient : public Application {
 	friend class SlidingClientPacketRecord;
 public:
+	enum TimerMode {
+		PER_PACKET_TIMER,	//!< One simulator event per unacked packet
+		SINGLE_TIMER		//!< One simulator event per client, armed for the oldest unacked packet
+	};
+
+	enum RetransmitMode {
+		RETRANSMIT_NONE,		//!< Timed out packets are dropped from the window
+		RETRANSMIT_GO_BACK_N,		//!< Resend the timed out packet and every packet sent after it
+		RETRANSMIT_SELECTIVE_REPEAT	//!< Resend only the timed out packet
+	};
+
+	typedef void (* BurstTracedCallback)(uint32_t packets);
+	typedef void (* RttSampleTracedCallback)(Time rtt);
+	typedef void (* CongestionTracedCallback)(uint64_t bytesInFlight);
+
 	static TypeId GetTypeId(void);
 
 	SlidingClient();
@@ -53,6 +139,18 @@ public:
 		return m_sentPackets;
 	}
 
+	inline uint64_t GetRetransmittedPackets() {
+		return m_retransmittedPackets;
+	}
+
+	inline uint64_t GetTimerEvents() {
+		return m_timerEvents;
+	}
+
+	inline uint64_t GetSendEvents() {
+		return m_sendEvents;
+	}
+
 protected:
 	virtual void DoDispose(void);
 
@@ -62,8 +160,22 @@ private:
 
 	void ScheduleNextPacket(uint64_t sendSize);
 	void SendPacket();
+	uint64_t SendSinglePacket(uint64_t toSend);
 	void BufferAvailableCb(Ptr<Socket>, uint32_t);
 	void AckAvailableCb(Ptr<Socket> socket);
+	void PacketTimeout(uint64_t seq);
+	uint64_t AckRange(uint64_t start, uint64_t end, Time& sampleSentTime, bool& hasSample);
+	void ArmRetransmitTimer(void);
+	void RetransmitTimeout();
+	void MarkLost(uint64_t seq);
+	bool Retransmit(uint64_t seq);
+	void UpdateRtt(Time rtt);
+	void EnterLoss(Time sentTime);
+	void UpdateCongestionState();
+
+	inline uint64_t GetEffectiveWindow() {
+		return std::min(m_windowSize, m_congestionState.m_cWnd);
+	}
 
 	Ptr<Socket>		m_socket;
 	Address			m_peer;
@@ -76,13 +188,52 @@ private:
 
 	EventId			m_sendEventId;
 	uint64_t		m_nextSendSize;
-
-	std::map<uint64_t, Ptr<SlidingClientPacketRecord>> m_unackedPackets;
+	uint64_t		m_pacingBurst;
+	Time			m_pacingTime;
+	Time			m_pacingTolerance;
+	bool			m_burstMode;
+	uint32_t		m_maxBurst;
+	bool			m_running;
+
+	Ptr<Packet>		m_payload;	//!< Zero-filled and never written, every data packet is a fragment of it
+	SlidingClientWindow	m_unackedPackets;
+	std::deque<uint64_t>	m_lostPackets;	//!< Sequence numbers to resend before new data
+	PacketAckHeader		m_ackHeader;	//!< Reused for every ACK, keeps the capacity of its SACK block list
+
+	TimerMode		m_timerMode;
+	RetransmitMode		m_retransmitMode;
+	EventId			m_retransmitEventId;
+
+	Time			m_initialRto;
+	Time			m_minRto;
+	Time			m_maxRto;
+	Time			m_srtt;
+	Time			m_rttVar;
+	Time			m_lastBackoffTime;
+	bool			m_rttValid;
+	TracedValue<Time>	m_lastRtt;
+	TracedValue<Time>	m_rto;
+
+	TypeId			m_congestionTypeId;
+	Ptr<SlidingCongestionOps> m_congestionOps;
+	SlidingCongestionState	m_congestionState;
+	TracedValue<uint64_t>	m_cWnd;
+	TracedValue<uint64_t>	m_ssThresh;
+	TracedValue<SlidingCongestionState::Phase> m_phase;
+	bool			m_recovering;
+	uint64_t		m_recoverySeq;	//!< Recovery ends once everything below it is acknowledged
 
 	uint64_t		m_sentPackets;
 	uint64_t		m_ackedPackets;
+	uint64_t		m_retransmittedPackets;
+	uint64_t		m_timerEvents;
+	uint64_t		m_sendEvents;
 
 	TracedCallback<Ptr<const Packet>> m_txTrace;
+	TracedCallback<Ptr<const Packet>> m_retransmitTrace;
+	TracedCallback<uint32_t> m_burstTrace;
+	TracedCallback<Time> m_rttSampleTrace;
+	TracedCallback<uint64_t> m_congestionTrace;
 };
 
 } // namespace ns3
@@ -0,0 +1,221 @@
+#include "sliding-congestion-ops.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("SlidingCongestionOps");
+
+SlidingCongestionState::SlidingCongestionState()
+	: m_cWnd(std::numeric_limits<uint64_t>::max())
+	, m_ssThresh(std::numeric_limits<uint64_t>::max())
+	, m_segmentSize(1400)
+	, m_bytesInFlight(0) {}
+
+
+NS_OBJECT_ENSURE_REGISTERED(SlidingCongestionOps);
+
+TypeId SlidingCongestionOps::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::SlidingCongestionOps")
+		.SetParent<Object>()
+		.SetGroupName("Applications")
+		;
+
+	return tid;
+}
+
+SlidingCongestionOps::SlidingCongestionOps() {}
+
+SlidingCongestionOps::~SlidingCongestionOps() {}
+
+SlidingCongestionState::Phase SlidingCongestionOps::GetPhase(const SlidingCongestionState& state) const {
+	return state.m_cWnd < state.m_ssThresh ? SlidingCongestionState::SLOW_START : SlidingCongestionState::CONGESTION_AVOIDANCE;
+}
+
+
+NS_OBJECT_ENSURE_REGISTERED(SlidingCongestionNone);
+
+TypeId SlidingCongestionNone::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::SlidingCongestionNone")
+		.SetParent<SlidingCongestionOps>()
+		.SetGroupName("Applications")
+		.AddConstructor<SlidingCongestionNone>()
+		;
+
+	return tid;
+}
+
+SlidingCongestionNone::SlidingCongestionNone() {}
+
+SlidingCongestionNone::~SlidingCongestionNone() {}
+
+std::string SlidingCongestionNone::GetName() const {
+	return "None";
+}
+
+void SlidingCongestionNone::Init(SlidingCongestionState& state) {
+	state.m_cWnd = std::numeric_limits<uint64_t>::max();
+	state.m_ssThresh = std::numeric_limits<uint64_t>::max();
+}
+
+void SlidingCongestionNone::IncreaseWindow(SlidingCongestionState&, uint64_t) {}
+
+void SlidingCongestionNone::ReduceWindow(SlidingCongestionState&) {}
+
+
+NS_OBJECT_ENSURE_REGISTERED(SlidingCongestionAimd);
+
+TypeId SlidingCongestionAimd::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::SlidingCongestionAimd")
+		.SetParent<SlidingCongestionOps>()
+		.SetGroupName("Applications")
+		.AddConstructor<SlidingCongestionAimd>()
+		.AddAttribute("InitialCwnd", "Initial congestion window in segments.",
+			UintegerValue(2),
+			MakeUintegerAccessor(&SlidingCongestionAimd::m_initialCwnd),
+			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("Beta", "Factor the window is multiplied with on loss.",
+			DoubleValue(0.5),
+			MakeDoubleAccessor(&SlidingCongestionAimd::m_beta),
+			MakeDoubleChecker<double>(0.0, 1.0))
+		;
+
+	return tid;
+}
+
+SlidingCongestionAimd::SlidingCongestionAimd()
+	: m_initialCwnd(2)
+	, m_beta(0.5) {}
+
+SlidingCongestionAimd::~SlidingCongestionAimd() {}
+
+std::string SlidingCongestionAimd::GetName() const {
+	return "Aimd";
+}
+
+void SlidingCongestionAimd::Init(SlidingCongestionState& state) {
+	state.m_cWnd = m_initialCwnd * state.m_segmentSize;
+	state.m_ssThresh = std::numeric_limits<uint64_t>::max();
+}
+
+void SlidingCongestionAimd::IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes) {
+	if (state.m_cWnd < state.m_ssThresh) {
+		state.m_cWnd += ackedBytes;
+	}
+	else {
+		// one segment per window of acknowledged data
+		state.m_cWnd += std::max<uint64_t>(1, state.m_segmentSize * ackedBytes / state.m_cWnd);
+	}
+}
+
+void SlidingCongestionAimd::ReduceWindow(SlidingCongestionState& state) {
+	uint64_t flight = std::min(state.m_cWnd, state.m_bytesInFlight);
+
+	state.m_ssThresh = std::max<uint64_t>(flight * m_beta, 2 * state.m_segmentSize);
+	state.m_cWnd = state.m_ssThresh;
+
+	NS_LOG_LOGIC("AIMD reduced window to " << state.m_cWnd);
+}
+
+
+NS_OBJECT_ENSURE_REGISTERED(SlidingCongestionCubic);
+
+TypeId SlidingCongestionCubic::GetTypeId(void) {
+	static TypeId tid = TypeId("ns3::SlidingCongestionCubic")
+		.SetParent<SlidingCongestionOps>()
+		.SetGroupName("Applications")
+		.AddConstructor<SlidingCongestionCubic>()
+		.AddAttribute("InitialCwnd", "Initial congestion window in segments.",
+			UintegerValue(2),
+			MakeUintegerAccessor(&SlidingCongestionCubic::m_initialCwnd),
+			MakeUintegerChecker<uint32_t>(1))
+		.AddAttribute("C", "Scaling constant of the cubic function in segments per second^3.",
+			DoubleValue(0.4),
+			MakeDoubleAccessor(&SlidingCongestionCubic::m_c),
+			MakeDoubleChecker<double>(0.0))
+		.AddAttribute("Beta", "Factor the window is multiplied with on loss.",
+			DoubleValue(0.7),
+			MakeDoubleAccessor(&SlidingCongestionCubic::m_beta),
+			MakeDoubleChecker<double>(0.0, 1.0))
+		;
+
+	return tid;
+}
+
+SlidingCongestionCubic::SlidingCongestionCubic()
+	: m_initialCwnd(2)
+	, m_c(0.4)
+	, m_beta(0.7)
+	, m_wMax(0)
+	, m_k(0)
+	, m_epochValid(false) {}
+
+SlidingCongestionCubic::~SlidingCongestionCubic() {}
+
+std::string SlidingCongestionCubic::GetName() const {
+	return "Cubic";
+}
+
+void SlidingCongestionCubic::Init(SlidingCongestionState& state) {
+	state.m_cWnd = m_initialCwnd * state.m_segmentSize;
+	state.m_ssThresh = std::numeric_limits<uint64_t>::max();
+
+	m_wMax = 0;
+	m_epochValid = false;
+}
+
+void SlidingCongestionCubic::IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes) {
+	if (state.m_cWnd < state.m_ssThresh) {
+		state.m_cWnd += ackedBytes;
+		return;
+	}
+
+	double segment = state.m_segmentSize;
+	double cWnd = state.m_cWnd / segment;
+
+	if (!m_epochValid) {
+		m_epochStart = Simulator::Now();
+		m_epochValid = true;
+
+		if (m_wMax <= cWnd) {
+			m_k = 0;
+			m_wMax = cWnd;
+		}
+		else {
+			m_k = std::cbrt((m_wMax - cWnd) / m_c);
+		}
+	}
+
+	// aim for the window the cubic function reaches one RTT from now, at most 1.5 times the current one
+	double t = (Simulator::Now() - m_epochStart + state.m_minRtt).GetSeconds();
+	double target = std::min(m_c * std::pow(t - m_k, 3) + m_wMax, 1.5 * cWnd);
+	double ackedSegments = ackedBytes / segment;
+
+	if (target > cWnd) {
+		state.m_cWnd += std::max<uint64_t>(1, segment * (target - cWnd) / cWnd * ackedSegments);
+	}
+	else {
+		state.m_cWnd += std::max<uint64_t>(1, segment * 0.01 * ackedSegments / cWnd);
+	}
+}
+
+void SlidingCongestionCubic::ReduceWindow(SlidingCongestionState& state) {
+	uint64_t flight = std::min(state.m_cWnd, state.m_bytesInFlight);
+
+	m_wMax = state.m_cWnd / static_cast<double>(state.m_segmentSize);
+	m_epochValid = false;
+
+	state.m_ssThresh = std::max<uint64_t>(flight * m_beta, 2 * state.m_segmentSize);
+	state.m_cWnd = state.m_ssThresh;
+
+	NS_LOG_LOGIC("CUBIC reduced window to " << state.m_cWnd << ", Wmax " << m_wMax << " segments");
+}
+
+} // namespace ns3
@@ -0,0 +1,127 @@
+#ifndef SLIDING_CONGESTION_OPS_H
+#define SLIDING_CONGESTION_OPS_H
+
+#include "ns3/core-module.h"
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Congestion state of one SlidingClient, all sizes in byte.
+ */
+class SlidingCongestionState {
+public:
+	enum Phase {
+		SLOW_START,		//!< Window below the slow start threshold
+		CONGESTION_AVOIDANCE,	//!< Window at or above the slow start threshold
+		RECOVERY		//!< After a loss, until everything sent before it is acknowledged
+	};
+
+	typedef void (* PhaseTracedCallback)(Phase oldValue, Phase newValue);
+
+	SlidingCongestionState();
+
+	uint64_t	m_cWnd;
+	uint64_t	m_ssThresh;
+	uint64_t	m_segmentSize;
+	uint64_t	m_bytesInFlight;
+	Time		m_lastRtt;
+	Time		m_minRtt;
+};
+
+/**
+ * Interface of the congestion control algorithms a SlidingClient can use,
+ * modelled after TcpCongestionOps.
+ */
+class SlidingCongestionOps : public Object {
+public:
+	static TypeId GetTypeId(void);
+
+	SlidingCongestionOps();
+	virtual ~SlidingCongestionOps();
+
+	virtual std::string GetName() const = 0;
+
+	virtual void Init(SlidingCongestionState& state) = 0;
+	virtual void IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes) = 0;
+	virtual void ReduceWindow(SlidingCongestionState& state) = 0;
+
+	/**
+	 * Slow start or congestion avoidance, the client tracks recovery itself.
+	 */
+	virtual SlidingCongestionState::Phase GetPhase(const SlidingCongestionState& state) const;
+};
+
+/**
+ * No congestion control, the window is only limited by WindowSize.
+ */
+class SlidingCongestionNone : public SlidingCongestionOps {
+public:
+	static TypeId GetTypeId(void);
+
+	SlidingCongestionNone();
+	virtual ~SlidingCongestionNone();
+
+	virtual std::string GetName() const;
+
+	virtual void Init(SlidingCongestionState& state);
+	virtual void IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes);
+	virtual void ReduceWindow(SlidingCongestionState& state);
+};
+
+/**
+ * Slow start followed by additive increase of one segment per window and
+ * multiplicative decrease on loss.
+ */
+class SlidingCongestionAimd : public SlidingCongestionOps {
+public:
+	static TypeId GetTypeId(void);
+
+	SlidingCongestionAimd();
+	virtual ~SlidingCongestionAimd();
+
+	virtual std::string GetName() const;
+
+	virtual void Init(SlidingCongestionState& state);
+	virtual void IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes);
+	virtual void ReduceWindow(SlidingCongestionState& state);
+
+private:
+	uint32_t	m_initialCwnd;
+	double		m_beta;
+};
+
+/**
+ * Window growth along the CUBIC function W(t) = C (t - K)^3 + Wmax of
+ * RFC 8312, without its TCP friendly region.
+ */
+class SlidingCongestionCubic : public SlidingCongestionOps {
+public:
+	static TypeId GetTypeId(void);
+
+	SlidingCongestionCubic();
+	virtual ~SlidingCongestionCubic();
+
+	virtual std::string GetName() const;
+
+	virtual void Init(SlidingCongestionState& state);
+	virtual void IncreaseWindow(SlidingCongestionState& state, uint64_t ackedBytes);
+	virtual void ReduceWindow(SlidingCongestionState& state);
+
+private:
+	uint32_t	m_initialCwnd;
+	double		m_c;
+	double		m_beta;
+
+	double		m_wMax;		//!< Window in segments before the last reduction
+	double		m_k;		//!< Time in seconds to grow back to m_wMax
+	Time		m_epochStart;
+	bool		m_epochValid;
+};
+
+} // namespace ns3
+
+#endif /* SLIDING_CONGESTION_OPS_H */
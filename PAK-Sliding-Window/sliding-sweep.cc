@@ -0,0 +1,327 @@
+#include "sliding-sweep.h"
+
+#include "ns3/log.h"
+#include "ns3/fatal-error.h"
+#include "../PAK-Common/pak-results.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <sys/wait.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("SlidingSweep");
+
+SlidingSweep::SlidingSweep(std::string program)
+	: m_program(program)
+	, m_seeds(1)
+	, m_nextRun(0)
+	, m_finishedRuns(0) {}
+
+void SlidingSweep::AddArgument(std::string argument) {
+	m_arguments.push_back(argument);
+}
+
+void SlidingSweep::AddGrid(std::string grid) {
+	std::vector<Values> sets(1);
+	std::vector<std::string> axes = Split(grid, ';');
+
+	for (std::vector<std::string>::iterator axis = axes.begin(); axis != axes.end(); ++axis) {
+		size_t eq = axis->find('=');
+
+		if (eq == std::string::npos) {
+			NS_FATAL_ERROR("Sweep axis \"" << *axis << "\" is not of the form name=value,value");
+		}
+
+		std::string name = axis->substr(0, eq);
+		std::vector<std::string> values = Split(axis->substr(eq + 1), ',');
+		std::vector<Values> product;
+		product.reserve(sets.size() * values.size());
+
+		for (std::vector<Values>::iterator set = sets.begin(); set != sets.end(); ++set) {
+			for (std::vector<std::string>::iterator value = values.begin(); value != values.end(); ++value) {
+				product.push_back(*set);
+				product.back().push_back(std::make_pair(name, *value));
+			}
+		}
+
+		sets.swap(product);
+	}
+
+	m_parameterSets.insert(m_parameterSets.end(), sets.begin(), sets.end());
+}
+
+void SlidingSweep::AddFile(std::string path) {
+	std::ifstream file(path.c_str());
+
+	if (!file) {
+		NS_FATAL_ERROR("Cannot read sweep file " << path);
+	}
+
+	std::string line;
+
+	while (std::getline(file, line)) {
+		std::istringstream tokens(line);
+		std::string token;
+		Values set;
+
+		while (tokens >> token) {
+			if (set.empty() && token[0] == '#') {
+				break;
+			}
+
+			size_t eq = token.find('=');
+
+			if (eq == std::string::npos) {
+				NS_FATAL_ERROR("Sweep parameter \"" << token << "\" in " << path << " is not of the form name=value");
+			}
+
+			set.push_back(std::make_pair(token.substr(0, eq), token.substr(eq + 1)));
+		}
+
+		if (!set.empty()) {
+			m_parameterSets.push_back(set);
+		}
+	}
+}
+
+void SlidingSweep::SetSeeds(uint32_t seeds) {
+	m_seeds = std::max(seeds, 1u);
+}
+
+uint32_t SlidingSweep::Run(uint32_t jobs, std::string output) {
+	m_runs.clear();
+	m_nextRun = 0;
+	m_finishedRuns = 0;
+
+	for (std::vector<Values>::iterator set = m_parameterSets.begin(); set != m_parameterSets.end(); ++set) {
+		for (uint32_t seed = 1; seed <= m_seeds; seed++) {
+			SweepRun run;
+			run.m_parameters = *set;
+			run.m_seed = seed;
+			run.m_status = -1;
+			run.m_signal = 0;
+			m_runs.push_back(run);
+		}
+	}
+
+	if (jobs == 0) {
+		jobs = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	jobs = std::min<uint32_t>(jobs, m_runs.size());
+	std::cout << "Sweeping " << m_runs.size() << " runs on " << jobs << " workers" << std::endl;
+
+	std::vector<std::thread> workers;
+
+	for (uint32_t i = 0; i < jobs; i++) {
+		workers.push_back(std::thread(&SlidingSweep::Work, this));
+	}
+
+	for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+		it->join();
+	}
+
+	// the columns are the union of all parameter and metric names in the order they first appear
+	std::vector<std::string> parameters;
+	std::vector<std::string> metrics;
+	uint32_t failed = 0;
+
+	for (std::vector<SweepRun>::iterator run = m_runs.begin(); run != m_runs.end(); ++run) {
+		for (Values::iterator it = run->m_parameters.begin(); it != run->m_parameters.end(); ++it) {
+			if (std::find(parameters.begin(), parameters.end(), it->first) == parameters.end()) {
+				parameters.push_back(it->first);
+			}
+		}
+
+		for (Values::iterator it = run->m_metrics.begin(); it != run->m_metrics.end(); ++it) {
+			if (std::find(metrics.begin(), metrics.end(), it->first) == metrics.end()) {
+				metrics.push_back(it->first);
+			}
+		}
+
+		if (run->m_status != 0 || run->m_signal != 0) {
+			failed++;
+		}
+	}
+
+	std::ofstream csv(output.c_str());
+
+	if (!csv) {
+		NS_FATAL_ERROR("Cannot write sweep results to " << output);
+	}
+
+	// quoted the same way as the --results files of single runs
+	std::vector<std::string> header;
+	header.push_back("run");
+	header.insert(header.end(), parameters.begin(), parameters.end());
+	header.push_back("seed");
+	header.push_back("status");
+	header.push_back("signal");
+	header.insert(header.end(), metrics.begin(), metrics.end());
+	csv << PakResults::FormatCsvRow(header) << std::endl;
+
+	for (uint32_t i = 0; i < m_runs.size(); i++) {
+		const SweepRun& run = m_runs[i];
+		std::vector<std::string> fields;
+		fields.push_back(std::to_string(i));
+
+		for (std::vector<std::string>::iterator name = parameters.begin(); name != parameters.end(); ++name) {
+			fields.push_back(Find(run.m_parameters, *name));
+		}
+
+		fields.push_back(std::to_string(run.m_seed));
+		fields.push_back(std::to_string(run.m_status));
+		fields.push_back(std::to_string(run.m_signal));
+
+		for (std::vector<std::string>::iterator name = metrics.begin(); name != metrics.end(); ++name) {
+			fields.push_back(Find(run.m_metrics, *name));
+		}
+
+		csv << PakResults::FormatCsvRow(fields) << std::endl;
+	}
+
+	std::cout << "Wrote " << m_runs.size() << " runs to " << output << ", " << failed << " failed" << std::endl;
+
+	return failed;
+}
+
+void SlidingSweep::Work(void) {
+	while (true) {
+		uint32_t index;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			if (m_nextRun >= m_runs.size()) {
+				return;
+			}
+
+			index = m_nextRun++;
+		}
+
+		// every worker only touches its own run, the vector itself is not resized while working
+		Execute(m_runs[index]);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finishedRuns++;
+		std::cout << "Run " << index;
+
+		if (m_runs[index].m_signal != 0) {
+			std::cout << " killed by signal " << m_runs[index].m_signal;
+		}
+		else {
+			std::cout << " finished with status " << m_runs[index].m_status;
+		}
+
+		std::cout << " (" << m_finishedRuns << "/" << m_runs.size() << ")" << std::endl;
+	}
+}
+
+void SlidingSweep::Execute(SweepRun& run) {
+	std::string command = GetCommand(run);
+	NS_LOG_INFO("Starting " << command);
+
+	FILE* pipe = popen(command.c_str(), "r");
+
+	if (pipe == NULL) {
+		NS_LOG_WARN("Cannot start " << command);
+		return;
+	}
+
+	char buffer[4096];
+	std::string line;
+
+	while (std::fgets(buffer, sizeof(buffer), pipe) != NULL) {
+		line += buffer;
+
+		if (line.empty() || line[line.size() - 1] != '\n') {
+			continue;
+		}
+
+		line.erase(line.size() - 1);
+		size_t tab = line.find('\t');
+
+		if (tab != std::string::npos) {
+			run.m_metrics.push_back(std::make_pair(line.substr(0, tab), line.substr(tab + 1)));
+		}
+
+		line.clear();
+	}
+
+	// pclose returns a wait status, not the exit code
+	int status = pclose(pipe);
+
+	if (status == -1) {
+		NS_LOG_WARN("Cannot wait for " << command);
+	}
+	else if (WIFEXITED(status)) {
+		run.m_status = WEXITSTATUS(status);
+	}
+	else if (WIFSIGNALED(status)) {
+		run.m_signal = WTERMSIG(status);
+	}
+}
+
+std::string SlidingSweep::GetCommand(const SweepRun& run) const {
+	std::ostringstream command;
+	command << Quote(m_program);
+
+	for (std::vector<std::string>::const_iterator it = m_arguments.begin(); it != m_arguments.end(); ++it) {
+		command << " " << Quote(*it);
+	}
+
+	for (Values::const_iterator it = run.m_parameters.begin(); it != run.m_parameters.end(); ++it) {
+		command << " " << Quote("--" + it->first + "=" + it->second);
+	}
+
+	command << " --RngRun=" << run.m_seed << " --sweepWorker=1";
+
+	return command.str();
+}
+
+std::string SlidingSweep::Quote(std::string argument) {
+	std::string quoted = "'";
+
+	for (std::string::iterator it = argument.begin(); it != argument.end(); ++it) {
+		if (*it == '\'') {
+			quoted += "'\\''";
+		}
+		else {
+			quoted += *it;
+		}
+	}
+
+	return quoted + "'";
+}
+
+std::string SlidingSweep::Find(const Values& values, const std::string& name) {
+	for (Values::const_iterator it = values.begin(); it != values.end(); ++it) {
+		if (it->first == name) {
+			return it->second;
+		}
+	}
+
+	return "";
+}
+
+std::vector<std::string> SlidingSweep::Split(std::string s, char delimiter) {
+	std::vector<std::string> parts;
+	std::istringstream stream(s);
+	std::string part;
+
+	while (std::getline(stream, part, delimiter)) {
+		if (!part.empty()) {
+			parts.push_back(part);
+		}
+	}
+
+	return parts;
+}
+
+} // namespace ns3
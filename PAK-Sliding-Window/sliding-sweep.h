@@ -0,0 +1,86 @@
+#ifndef SLIDING_SWEEP_H
+#define SLIDING_SWEEP_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Runs the scenario once per parameter set and seed, each run in its own
+ * process of the scenario binary, and merges the metrics of all runs into
+ * one CSV file. Each worker thread keeps one process running at a time.
+ *
+ * A run prints one "name<TAB>value" line per metric, which is what the
+ * scenario does when started with --sweepWorker=1.
+ */
+class SlidingSweep {
+public:
+	typedef std::vector<std::pair<std::string, std::string> > Values;
+
+	SlidingSweep(std::string program);
+
+	/**
+	 * Argument passed unchanged to every run.
+	 */
+	void AddArgument(std::string argument);
+
+	/**
+	 * Adds the cartesian product of a grid like "windowSize=10000,25000;packetSize=500,1400".
+	 */
+	void AddGrid(std::string grid);
+
+	/**
+	 * Adds one parameter set per line of the file, written as
+	 * "name=value name=value". Empty lines and lines starting with # are skipped.
+	 */
+	void AddFile(std::string path);
+
+	/**
+	 * Every parameter set is run with the ns-3 run numbers 1 to seeds.
+	 */
+	void SetSeeds(uint32_t seeds);
+
+	/**
+	 * Runs everything on jobs workers, 0 uses one worker per core, and
+	 * writes the CSV file. Returns the number of failed runs.
+	 */
+	uint32_t Run(uint32_t jobs, std::string output);
+
+private:
+	struct SweepRun {
+		Values		m_parameters;
+		uint32_t	m_seed;
+		Values		m_metrics;
+		int		m_status;	//!< Exit code, -1 if the run could not be started or did not exit
+		int		m_signal;	//!< Signal that terminated the run, 0 if none
+	};
+
+	void Work(void);
+	void Execute(SweepRun& run);
+	std::string GetCommand(const SweepRun& run) const;
+	static std::string Quote(std::string argument);
+	static std::vector<std::string> Split(std::string s, char delimiter);
+
+	/**
+	 * Value of name in values, empty if it is not there.
+	 */
+	static std::string Find(const Values& values, const std::string& name);
+
+	std::string	m_program;
+	std::vector<std::string> m_arguments;
+	std::vector<Values> m_parameterSets;
+	uint32_t	m_seeds;
+
+	std::vector<SweepRun> m_runs;
+	std::mutex	m_mutex;
+	uint32_t	m_nextRun;	//!< Next run a worker picks up, guarded by m_mutex
+	uint32_t	m_finishedRuns;
+};
+
+} // namespace ns3
+
+#endif /* SLIDING_SWEEP_H */
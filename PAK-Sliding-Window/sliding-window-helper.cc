@@ -0,0 +1,106 @@
+#include "sliding-window-helper.h"
+#include "ns3/names.h"
+#include "ns3/node.h"
+
+namespace ns3 {
+
+SlidingClientHelper::SlidingClientHelper(Address address)
+	: m_stagger(false)
+	, m_jitterVariable(CreateObject<UniformRandomVariable>()) {
+	m_factory.SetTypeId("ns3::SlidingClient");
+	m_factory.Set("Remote", AddressValue(address));
+}
+
+void SlidingClientHelper::SetAttribute(std::string name, const AttributeValue &value) {
+	m_factory.Set(name, value);
+}
+
+void SlidingClientHelper::SetStartTimes(Time start, Time interval, Time jitter) {
+	m_stagger = true;
+	m_start = start;
+	m_interval = interval;
+	m_jitter = jitter;
+}
+
+ApplicationContainer SlidingClientHelper::Install(Ptr<Node> node) const {
+	return ApplicationContainer(InstallPriv(node, 0));
+}
+
+ApplicationContainer SlidingClientHelper::Install(std::string nodeName) const {
+	Ptr<Node> node = Names::Find<Node>(nodeName);
+
+	return ApplicationContainer(InstallPriv(node, 0));
+}
+
+ApplicationContainer SlidingClientHelper::Install(NodeContainer c) const {
+	ApplicationContainer apps;
+	uint32_t index = 0;
+	for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i) {
+		apps.Add(InstallPriv(*i, index++));
+	}
+
+	return apps;
+}
+
+ApplicationContainer SlidingClientHelper::Install(NodeContainer c, const std::vector<Address>& remotes) const {
+	NS_ASSERT_MSG(remotes.size() == c.GetN(), "One remote address per node is required");
+
+	ApplicationContainer apps;
+	uint32_t index = 0;
+	for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i) {
+		Ptr<Application> app = InstallPriv(*i, index);
+		app->SetAttribute("Remote", AddressValue(remotes[index]));
+		apps.Add(app);
+		index++;
+	}
+
+	return apps;
+}
+
+Ptr<Application> SlidingClientHelper::InstallPriv(Ptr<Node> node, uint32_t index) const {
+	Ptr<Application> app = m_factory.Create<Application>();
+	if (m_stagger) {
+		Time jitter = m_jitter.IsStrictlyPositive() ? Seconds(m_jitterVariable->GetValue(0, m_jitter.GetSeconds())) : Seconds(0);
+		app->SetStartTime(m_start + m_interval * index + jitter);
+	}
+	node->AddApplication(app);
+
+	return app;
+}
+
+
+AckServerHelper::AckServerHelper() {
+	m_factory.SetTypeId("ns3::AckServerApplication");
+}
+
+void AckServerHelper::SetAttribute(std::string name, const AttributeValue &value) {
+	m_factory.Set(name, value);
+}
+
+ApplicationContainer AckServerHelper::Install(Ptr<Node> node) const {
+	return ApplicationContainer(InstallPriv(node));
+}
+
+ApplicationContainer AckServerHelper::Install(std::string nodeName) const {
+	Ptr<Node> node = Names::Find<Node>(nodeName);
+
+	return ApplicationContainer(InstallPriv(node));
+}
+
+ApplicationContainer AckServerHelper::Install(NodeContainer c) const {
+	ApplicationContainer apps;
+	for (NodeContainer::Iterator i = c.Begin(); i != c.End(); ++i) {
+		apps.Add(InstallPriv(*i));
+	}
+
+	return apps;
+}
+
+Ptr<Application> AckServerHelper::InstallPriv(Ptr<Node> node) const {
+	Ptr<Application> app = m_factory.Create<Application>();
+	node->AddApplication(app);
+
+	return app;
+}
+
+} // namespace ns3
@@ -0,0 +1,74 @@
+#ifndef SLIDING_WINDOW_HELPER_H
+#define SLIDING_WINDOW_HELPER_H
+
+#include "ns3/object-factory.h"
+#include "ns3/address.h"
+#include "ns3/attribute.h"
+#include "ns3/nstime.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+#include "ns3/random-variable-stream.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Installs SlidingClient applications, optionally with staggered start times.
+ */
+class SlidingClientHelper {
+public:
+	SlidingClientHelper(Address address);
+
+	void SetAttribute(std::string name, const AttributeValue &value);
+
+	/**
+	 * The i-th installed client starts at start + i * interval, plus a
+	 * uniformly random delay below jitter drawn from the ns-3 run number.
+	 * Without a call the start times are left to ApplicationContainer::Start.
+	 */
+	void SetStartTimes(Time start, Time interval, Time jitter = Seconds(0));
+
+	ApplicationContainer Install(NodeContainer c) const;
+	ApplicationContainer Install(Ptr<Node> node) const;
+	ApplicationContainer Install(std::string nodeName) const;
+
+	/**
+	 * Installs one client on every node of c, the i-th one sending to remotes[i].
+	 */
+	ApplicationContainer Install(NodeContainer c, const std::vector<Address>& remotes) const;
+
+private:
+	Ptr<Application> InstallPriv(Ptr<Node> node, uint32_t index) const;
+
+	ObjectFactory	m_factory;	//!< Object factory.
+	bool		m_stagger;	//!< True if the start times are set by the helper
+	Time		m_start;	//!< Start time of the first client
+	Time		m_interval;	//!< Time between the starts of two clients
+	Time		m_jitter;	//!< Upper bound of the random delay added to each start
+	Ptr<UniformRandomVariable> m_jitterVariable;
+};
+
+/**
+ * Installs AckServerApplication applications.
+ */
+class AckServerHelper {
+public:
+	AckServerHelper();
+
+	void SetAttribute(std::string name, const AttributeValue &value);
+
+	ApplicationContainer Install(NodeContainer c) const;
+	ApplicationContainer Install(Ptr<Node> node) const;
+	ApplicationContainer Install(std::string nodeName) const;
+
+private:
+	Ptr<Application> InstallPriv(Ptr<Node> node) const;
+
+	ObjectFactory m_factory; //!< Object factory.
+};
+
+} // namespace ns3
+
+#endif /* SLIDING_WINDOW_HELPER_H */
@@ -29,6 +29,10 @@
 #include <string>
 #include <fstream>
 
+#include "../PAK-Common/pak-results.h"
+#include "../PAK-Common/pak-pcap.h"
+#include "../PAK-Common/pak-stats.h"
+
 #define	SWING_IN	30
 #define	COOL_DOWN	30
 
@@ -58,12 +62,25 @@ int main(int argc, char *argv[]) {
 	std::string delay = "10ms";
 	uint32_t runtime = 300;
 
+	PakResults results("PAK-TCP-Model");
+	PakPcap pcap("pak-tcp-model");
+	PakFlowStats stats;
+
 	CommandLine cmd;
 	cmd.AddValue("datarate", "Link datarate value", datarate);
 	cmd.AddValue("delay", "Link delay value", delay);
 	cmd.AddValue("runtime", "Simulation run time", runtime);
+	results.AddOptions(cmd);
+	pcap.AddOptions(cmd);
+	stats.AddOptions(cmd);
 	cmd.Parse(argc, argv);
 
+	results.SetParameter("datarate", datarate);
+	results.SetParameter("delay", delay);
+	results.SetParameter("runtime", runtime);
+	results.SetParameter("pcap", pcap.GetMode());
+	results.SetParameter("pcapSnapLen", pcap.GetSnapLen());
+
 
 	NS_LOG_INFO("Create nodes.");
 	NodeContainer nodes;
@@ -106,19 +123,29 @@ int main(int argc, char *argv[]) {
 	sinkApps.Stop(Seconds(runtime + SWING_IN + COOL_DOWN));
 
 	
-	pointToPoint.EnablePcapAll("pak-tcp-model", false);
+	pcap.Enable(pointToPoint);
 
 
 	Config::ConnectWithoutContext("/NodeList/0/DeviceList/0/$ns3::PointToPointNetDevice/TxQueue/Enqueue", MakeCallback(&enqueueCb));
 	Config::ConnectWithoutContext("/NodeList/1/DeviceList/0/$ns3::PointToPointNetDevice/TxQueue/Drop", MakeCallback(&dropCb));
 
+	if (stats.IsEnabled()) {
+		stats.Init(Seconds(runtime + SWING_IN + COOL_DOWN));
+		sourceApps.Get(0)->TraceConnectWithoutContext("Tx", MakeCallback(&PakFlowStats::Tx, &stats));
+		sinkApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&PakFlowStats::Rx, &stats));
+		Config::ConnectWithoutContext("/NodeList/0/DeviceList/0/$ns3::PointToPointNetDevice/TxQueue/Enqueue", MakeCallback(&PakFlowStats::Enqueue, &stats));
+		Config::ConnectWithoutContext("/NodeList/0/DeviceList/0/$ns3::PointToPointNetDevice/TxQueue/Drop", MakeCallback(&PakFlowStats::Drop, &stats));
+	}
+
 
 	Simulator::Schedule(Seconds(SWING_IN), &swingInReset);
 
 
 	NS_LOG_INFO("Run Simulation.");
 	Simulator::Stop(Seconds(runtime + SWING_IN + COOL_DOWN));
+	results.StartRun();
 	Simulator::Run();
+	results.StopRun();
 	Simulator::Destroy();
 	NS_LOG_INFO("Done.");
 
@@ -127,9 +154,11 @@ int main(int argc, char *argv[]) {
 	// Ptr<PacketSink> sink1 = DynamicCast<PacketSink>(sinkApps.Get(0));
 	// std::cout << "Total Bytes Received: " << sink1->GetTotalRx() << std::endl;
 
-	std::cout << "Total packages sent: " << sentCnt << std::endl;
-	std::cout << "Total packages received: " << (sentCnt - dropCnt) << std::endl;
-	std::cout << "Total packages dropped: " << dropCnt << std::endl;
+	results.AddMetric("Total packages sent", static_cast<uint64_t>(sentCnt));
+	results.AddMetric("Total packages received", static_cast<uint64_t>(sentCnt - dropCnt));
+	results.AddMetric("Total packages dropped", static_cast<uint64_t>(dropCnt));
+	stats.Write(results);
+	results.Write();
 
 
 	return 0;